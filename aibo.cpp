@@ -29,6 +29,7 @@ typedef struct s_popts {
   float errorReduction;
   float insertErrorReduction;
   int totalIterations;
+  int decodeScale;
 } ProgOpts;
 
 bool parse_args(int argc, char* argv[], ProgOpts& popts);
@@ -56,6 +57,7 @@ int main(int argc, char* argv[]) {
   QObject::connect(&aibo, SIGNAL(cameraFrame(QImage)),
                    &viewer, SLOT(setImage(QImage)));
   
+  aibo.setCameraDecodeScale(popts.decodeScale);
   aibo.startCamera();
   
   // set command-line parameters
@@ -95,7 +97,8 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
      ("targetError,e", po::value<float>(&popts.targetError)->default_value(0.001), "Continue inserting nodes until the average error has reached this threshold")
      ("errorReduction,r", po::value<float>(&popts.errorReduction)->default_value(0.1), "All errors are reduced by this amount each GNG step")
      ("insertErrorReduction,s", po::value<float>(&popts.insertErrorReduction)->default_value(0.5), "Reduce new unit's error by this much")
-     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total");
+     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total")
+     ("decodeScale", po::value<int>(&popts.decodeScale)->default_value(1), "Decode camera frames at 1/n of the sent resolution (1, 2, 4 or 8)");
    po::variables_map vm;
    po::store(po::parse_command_line(argc, argv, desc), vm);
    po::notify(vm);
@@ -0,0 +1,158 @@
+// Runs an AiboSource against a robot or aibosim for a while and reports
+// the frame rate, the decode latency and how quickly frames are sampled:
+//
+//   ./aibosim --fps 30 &
+//   ./aibobench --hostname localhost --seconds 10
+
+#include "aibobench.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+
+#include <libgng/clock.h>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+namespace po=boost::program_options;
+using std::string;
+using namespace GNG;
+
+AiboBenchmark::AiboBenchmark(AiboSource* source)
+  : m_source(source),
+    m_framesArrived(0),
+    m_decodeLatencySum(0),
+    m_decodeLatencyMax(0),
+    m_samples(0),
+    m_framesSampled(0),
+    m_availabilitySum(0),
+    m_availabilityMax(0)
+{
+}
+
+void AiboBenchmark::frameArrived()
+{
+  qreal latency = m_source->cameraDecodeLatency();
+  m_framesArrived++;
+  m_decodeLatencySum += latency;
+  m_decodeLatencyMax = qMax(m_decodeLatencyMax, latency);
+
+  m_arrivalsAccess.lock();
+  m_arrivals.insert(m_source->cameraYCbCr().cacheKey(), monotonicTime());
+  m_arrivalsAccess.unlock();
+}
+
+void AiboBenchmark::run()
+{
+  qint64 lastFrame = 0;
+  while (!m_stopped) {
+    m_source->generatePoint();
+    m_samples++;
+
+    qint64 frame = m_source->sampledFrame();
+    if (frame == lastFrame) {
+      continue;
+    }
+
+    qint64 now = monotonicTime();
+    m_arrivalsAccess.lock();
+    qint64 arrival = m_arrivals.take(frame);
+    m_arrivalsAccess.unlock();
+    if (arrival == 0) {
+      // The black frame from before the camera started, or a frame that
+      // is sampled before frameArrived() saw it. Look again next time.
+      continue;
+    }
+    lastFrame = frame;
+    m_framesSampled++;
+    m_availabilitySum += now - arrival;
+    m_availabilityMax = qMax(m_availabilityMax, now - arrival);
+  }
+}
+
+void AiboBenchmark::report(qreal seconds)
+{
+  m_stopped = 1;
+  wait();
+
+  int received = m_source->cameraFramesReceived();
+  printf("Frames received:   %d (%.1f fps)\n", received, received/seconds);
+  printf("Frames decoded:    %d (%.1f fps), %d dropped before decoding\n",
+         m_framesArrived, m_framesArrived/seconds, m_source->cameraFramesDropped());
+  if (m_framesArrived > 0) {
+    printf("Decode latency:    %.2f ms average, %.2f ms max\n",
+           m_decodeLatencySum/m_framesArrived, m_decodeLatencyMax);
+  }
+  printf("Frames sampled:    %d, %d never sampled\n", m_framesSampled, m_framesArrived - m_framesSampled);
+  if (m_framesSampled > 0) {
+    printf("Sample available:  %.2f ms average, %.2f ms max after decoding\n",
+           m_availabilitySum/1e6/m_framesSampled, m_availabilityMax/1e6);
+  }
+  printf("Samples drawn:     %lld (%.0f per second)\n", m_samples, m_samples/seconds);
+}
+
+
+typedef struct s_popts {
+  string hostname;
+  int seconds;
+  int resolution;
+  int decodeScale;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  AiboSource aibo(QString::fromStdString(popts.hostname));
+  AiboBenchmark benchmark(&aibo);
+  QObject::connect(&aibo, SIGNAL(cameraFrameReady()),
+                   &benchmark, SLOT(frameArrived()), Qt::DirectConnection);
+  aibo.setCameraDecodeScale(popts.decodeScale);
+
+  aibo.startCamera((Aibo::Resolution)qBound(0, popts.resolution, 2));
+  benchmark.start();
+
+  // Aibo connects to the camera server a second after starting it
+  QTimer::singleShot((popts.seconds + 1)*1000, &app, SLOT(quit()));
+  app.exec();
+
+  benchmark.report(popts.seconds);
+  aibo.stopCamera();
+  return 0;
+};
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("hostname,p", po::value<string>(&popts.hostname)->default_value("localhost"), "Aibo's (or aibosim's) hostname")
+     ("seconds,t", po::value<int>(&popts.seconds)->default_value(10), "Measure for this many seconds")
+     ("resolution,r", po::value<int>(&popts.resolution)->default_value(1), "0 for 416x320, 1 for 208x160, 2 for 104x80")
+     ("decodeScale,s", po::value<int>(&popts.decodeScale)->default_value(1), "Decode frames at 1/n of the sent resolution (1, 2, 4 or 8)");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if (vm.count("help")){
+     std::cout << desc;
+           return false;
+   }
+   return true;
+}
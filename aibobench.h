@@ -0,0 +1,49 @@
+#ifndef AIBOBENCH_H
+#define AIBOBENCH_H
+
+#include <QObject>
+#include <QThread>
+#include <QImage>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+
+#include <libgng/aibosource.h>
+
+/**
+    Measures the camera path of an AiboSource: how many frames arrive,
+    how long they take to decode and how long after arriving the first
+    point is drawn from them.
+*/
+class AiboBenchmark : public QThread {
+  Q_OBJECT
+  public:
+    AiboBenchmark(GNG::AiboSource *source);
+
+    /** Stops sampling and prints the results for the given duration */
+    void report(qreal seconds);
+
+  public slots:
+    void frameArrived();
+
+  protected:
+    /** Draws points from the source as fast as it can */
+    virtual void run();
+
+  private:
+    GNG::AiboSource *m_source;
+
+    QMutex m_arrivalsAccess;
+    QHash<qint64, qint64> m_arrivals; // cacheKey() to arrival time
+    int m_framesArrived;
+    qreal m_decodeLatencySum;
+    qreal m_decodeLatencyMax;
+
+    QAtomicInt m_stopped;
+    qint64 m_samples;
+    int m_framesSampled;
+    qint64 m_availabilitySum; // nanoseconds from arrival to first sample
+    qint64 m_availabilityMax;
+};
+
+#endif //AIBOBENCH_H
@@ -3,63 +3,137 @@
 using namespace GNG;
 
 // constructor
-AiboFocus::AiboFocus(GrowingNeuralGas* gng, Aibo* aibo) 
+AiboFocus::AiboFocus(GrowingNeuralGas* gng, Aibo* aibo)
   : m_gng(gng),
-    m_modifyX(true)
-{ 
-  m_aibo = new AiboControl(aibo);
-  connect(&m_timer, SIGNAL(timeout()), SLOT(followObject()));
+    m_aibo(aibo),
+    m_following(false),
+    m_gain(0.5),
+    m_deadZone(0.05),
+    m_stepInterval(0),
+    m_lastStep(-1),
+    m_pan(0),
+    m_tilt(0),
+    m_updates(0),
+    m_latencySum(0),
+    m_latencyMax(0)
+{
+  connect(m_aibo, SIGNAL(cameraFrameReady()), SLOT(frameArrived()));
+  connect(m_gng, SIGNAL(updated()), SLOT(gngUpdated()));
 }
 
 AiboFocus::~AiboFocus()
 {
-  delete m_aibo;
 }
 
 void AiboFocus::setColor(QColor focusColor)
 {
   m_focusColor = focusColor.toHsl();
- 
+
   m_aibo->startHeadControl();
   m_gng->generateSubgraphs();
   m_gng->assignFollowSubgraph(m_focusColor);
-  m_timer.start(1000);
+  m_following = true;
+  m_reportTimer.start();
+}
+
+void AiboFocus::frameArrived()
+{
+  m_frameArrived.start();
+  if (m_stepInterval == 0) {
+    followObject();
+  }
+}
+
+void AiboFocus::gngUpdated()
+{
+  if (m_stepInterval > 0 && m_gng->currentStep() - m_lastStep >= m_stepInterval) {
+    followObject();
+  }
 }
 
 void AiboFocus::followObject()
 {
+  if (!m_following) {
+    return;
+  }
+
+  // Nothing to track anew if the GNG hasn't moved since the last update
+  int step = m_gng->currentStep();
+  if (step == m_lastStep) {
+    return;
+  }
+  m_lastStep = step;
+
   m_gng->generateSubgraphs();
   m_gng->matchingSubgraph();
-  Point center = m_gng->followSubgraph().center();
-
-  qDebug() << "*********\nCenter: " << center[0] << ", " <<
-    center[1] << ", " << center[2] << ", " << center[3] <<
-    ", " << center[4] << "\n************";
-  
-  // get x and y coordinates of center
-  qreal x = center[0];
-  qreal y = center[1];
-  
- 
-  if (m_modifyX){
-    if (x < 0.33){
-      qDebug() << "Aibo Move Left";
-      m_aibo->moveFocusLeft();
-    } else if (x > 0.66){
-      qDebug() << "Aibo Move Right";
-      m_aibo->moveFocusRight();
-    } else {
-      qDebug() << "Aibo Stop Moving";
-      m_aibo->moveFocusCenter();
+  if (m_gng->followSubgraph().isEmpty()) {
+    // Lost it, pick the subgraph closest to the focus color again
+    if (m_gng->subgraphs().isEmpty()) {
+      return;
     }
-  } else {
-    if (y < 0.66){
-      m_aibo->moveFocusUp();
-    } else {
-      m_aibo->moveFocusDown();
+    m_gng->assignFollowSubgraph(m_focusColor);
+    if (m_gng->followSubgraph().isEmpty()) {
+      return;
     }
   }
-  
-  m_modifyX = !m_modifyX;
- 
+  Point center = m_gng->followSubgraph().center();
+
+  // Offset of the center from the middle of the image, in [-0.5, 0.5]
+  qreal x = center[0] - 0.5;
+  qreal y = center[1] - 0.5;
+
+  // Pan is 1 (left) to -1 (right), tilt 0 (ahead) to -1 (down).
+  // Both are adjusted at once, proportionally to the offset
+  if (qAbs(x) > m_deadZone) {
+    m_pan = qBound(qreal(-1), m_pan - 2*m_gain*x, qreal(1));
+    m_aibo->setPan(m_pan);
+  }
+  if (qAbs(y) > m_deadZone) {
+    m_tilt = qBound(qreal(-1), m_tilt - 2*m_gain*y, qreal(0));
+    m_aibo->setTilt(m_tilt);
+  }
+
+  if (m_frameArrived.isValid()) {
+    qint64 latency = m_frameArrived.nsecsElapsed() / 1000;
+    m_updates++;
+    m_latencySum += latency;
+    m_latencyMax = qMax(m_latencyMax, latency);
+  }
+
+  if (m_reportTimer.elapsed() > 5000) {
+    reportLatency();
+  }
+}
+
+void AiboFocus::reportLatency()
+{
+  qDebug() << "Focus: pan" << m_pan << "tilt" << m_tilt << "-" << m_updates << "updates,"
+           << averageLatency() << "ms average and" << maxLatency() << "ms max from frame to command,"
+           << m_aibo->controlLatency() << "ms from command to send";
+  m_reportTimer.start();
+  m_updates = 0;
+  m_latencySum = 0;
+  m_latencyMax = 0;
+}
+
+qreal AiboFocus::averageLatency() const
+{
+  if (m_updates == 0) {
+    return 0;
+  }
+  return m_latencySum / 1000.0 / m_updates;
 }
+qreal AiboFocus::maxLatency() const
+{
+  return m_latencyMax / 1000.0;
+}
+
+// Getters
+qreal AiboFocus::gain() const { return m_gain; }
+qreal AiboFocus::deadZone() const { return m_deadZone; }
+int AiboFocus::stepInterval() const { return m_stepInterval; }
+
+// Setters
+void AiboFocus::setGain(qreal gain) { m_gain = gain; }
+void AiboFocus::setDeadZone(qreal deadZone) { m_deadZone = deadZone; }
+void AiboFocus::setStepInterval(int steps) { m_stepInterval = qMax(steps, 0); }
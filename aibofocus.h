@@ -2,34 +2,66 @@
 #define _AIBO_FOCUS_H
 
 
-#include "ui_aiboremote.h"
-
 #include <QDebug>
-#include <QApplication>
 #include <QColor>
-#include <QTimer>
+#include <QElapsedTimer>
 
 #include <libaibo/aibo.h>
 #include <libgng/aibosource.h>
-#include <libaibo/aibocontrol.h>
 #include <libgng/gng.h>
 
-class AiboFocus : QObject {
+/**
+    Keeps the head of the Aibo pointed at the subgraph with the focus
+    color. Runs on every camera frame, or every stepInterval() GNG steps,
+    and moves pan and tilt together by gain() times the offset of the
+    subgraph from the image center.
+*/
+class AiboFocus : public QObject {
   Q_OBJECT
   public:
     AiboFocus(GNG::GrowingNeuralGas* gng, Aibo* aibo);
     ~AiboFocus();
     void setColor(QColor focusColor);
-    
+
+    void setGain(qreal gain); /**< Fraction of the offset from the image center corrected per update */
+    void setDeadZone(qreal deadZone); /**< Offsets smaller than this are left alone */
+    /** Update every this many GNG steps instead of on every camera frame. 0 follows the frames */
+    void setStepInterval(int steps);
+
+    qreal gain() const;
+    qreal deadZone() const;
+    int stepInterval() const;
+
+    qreal averageLatency() const; /**< Milliseconds from frame arrival to the head command */
+    qreal maxLatency() const;
+
   public slots:
     void followObject();
-    
+
+  private slots:
+    void frameArrived();
+    void gngUpdated();
+
   private:
+    void reportLatency();
+
     GNG::GrowingNeuralGas* m_gng;
-    AiboControl* m_aibo;    
+    Aibo* m_aibo;
     QColor m_focusColor;
-    QTimer m_timer;
-    bool m_modifyX;
+    bool m_following;
+
+    qreal m_gain;
+    qreal m_deadZone;
+    int m_stepInterval;
+    int m_lastStep; // GNG step of the last update
+    qreal m_pan;
+    qreal m_tilt;
+
+    QElapsedTimer m_frameArrived;
+    QElapsedTimer m_reportTimer;
+    int m_updates;
+    qint64 m_latencySum; // microseconds
+    qint64 m_latencyMax;
 };
 
-#endif // _AIBO_FOCUS_H
\ No newline at end of file
+#endif // _AIBO_FOCUS_H
@@ -0,0 +1,335 @@
+#include "aibosim.h"
+
+#include <QCoreApplication>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+#include <QDir>
+#include <QFile>
+#include <QBuffer>
+#include <QDebug>
+
+#include <libaibo/aibo.h>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+namespace po=boost::program_options;
+using std::string;
+
+AiboSimulator::AiboSimulator(QObject* parent)
+  : QObject(parent),
+    m_size(208, 160),
+    m_quality(85),
+    m_verbose(false),
+    m_frameNumber(0),
+    m_framesSent(0),
+    m_framesSkipped(0),
+    m_bytesSent(0),
+    m_controlPackets(0)
+{
+  m_frameTimer.setInterval(50);
+  connect(&m_frameTimer, SIGNAL(timeout()), SLOT(sendFrame()));
+  m_statsTimer.setInterval(5000);
+  connect(&m_statsTimer, SIGNAL(timeout()), SLOT(printStats()));
+  m_clock.start();
+}
+
+AiboSimulator::~AiboSimulator()
+{
+}
+
+int AiboSimulator::loadImages(const QString& directory)
+{
+  QStringList filters;
+  filters << "*.jpg" << "*.jpeg" << "*.png" << "*.ppm";
+  QDir dir(directory);
+  foreach (const QString &name, dir.entryList(filters, QDir::Files, QDir::Name)) {
+    QImage image(dir.filePath(name));
+    if (image.isNull()) {
+      qWarning() << "Could not load" << dir.filePath(name);
+      continue;
+    }
+    m_images.append(image);
+  }
+  m_encoded.clear();
+  return m_images.size();
+}
+
+int AiboSimulator::loadRecording(const QString& fileName)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Could not open" << fileName;
+    return 0;
+  }
+
+  CameraStream stream;
+  stream.readFrom(&file);
+  CameraPacket packet;
+  while (stream.next(&packet)) {
+    m_recording.append(packet);
+  }
+  return m_recording.size();
+}
+
+void AiboSimulator::setFrameRate(int fps)
+{
+  m_frameTimer.setInterval(1000 / qMax(fps, 1));
+}
+void AiboSimulator::setResolution(const QSize& size)
+{
+  if (size != m_size) {
+    m_size = size;
+    m_encoded.clear();
+  }
+}
+void AiboSimulator::setQuality(int quality)
+{
+  m_quality = qBound(0, quality, 100);
+  m_encoded.clear();
+}
+void AiboSimulator::setVerbose(bool verbose)
+{
+  m_verbose = verbose;
+}
+
+bool AiboSimulator::listen()
+{
+  QList<int> ports;
+  ports << Aibo::MainControl << Aibo::RawCamServer << Aibo::HeadRemoteControl
+        << Aibo::WalkRemoteControl << Aibo::EStopRemoteControl;
+
+  foreach (int port, ports) {
+    QTcpServer *server = new QTcpServer(this);
+    if (!server->listen(QHostAddress::Any, port)) {
+      qWarning() << "Could not listen on port" << port << ":" << server->errorString();
+      return false;
+    }
+    connect(server, SIGNAL(newConnection()), SLOT(acceptConnection()));
+    m_servers.insert(server, port);
+  }
+
+  m_frameTimer.start();
+  m_statsTimer.start();
+  return true;
+}
+
+void AiboSimulator::acceptConnection()
+{
+  QTcpServer *server = qobject_cast<QTcpServer*>(sender());
+  int port = m_servers.value(server);
+
+  while (server->hasPendingConnections()) {
+    QTcpSocket *socket = server->nextPendingConnection();
+    socket->setProperty("port", port);
+    connect(socket, SIGNAL(disconnected()), SLOT(clientDisconnected()));
+    qDebug() << "Client" << socket->peerAddress().toString() << "connected to port" << port;
+
+    switch (port) {
+      case Aibo::MainControl:
+      case Aibo::EStopRemoteControl:
+        connect(socket, SIGNAL(readyRead()), SLOT(readMain()));
+        break;
+      case Aibo::HeadRemoteControl:
+      case Aibo::WalkRemoteControl:
+        connect(socket, SIGNAL(readyRead()), SLOT(readControl()));
+        break;
+      case Aibo::RawCamServer:
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_cameraClients.append(socket);
+        break;
+    }
+  }
+}
+
+void AiboSimulator::clientDisconnected()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  qDebug() << "Client disconnected from port" << socket->property("port").toInt();
+  m_cameraClients.removeAll(socket);
+  socket->deleteLater();
+}
+
+// Commands are lines of text
+void AiboSimulator::readMain()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  while (socket->canReadLine()) {
+    QString command = QString::fromAscii(socket->readLine()).trimmed();
+    qDebug() << "Port" << socket->property("port").toInt() << "command:" << command;
+    handleCommand(command);
+  }
+}
+
+void AiboSimulator::handleCommand(const QString& command)
+{
+  // Aibo::startCamera() picks the resolution through the y skip
+  const QString ySkip("!set vision.rawcam_y_skip=");
+  if (command.startsWith(ySkip)) {
+    int skip = command.mid(ySkip.size()).toInt();
+    setResolution(QSize(416 >> skip, 320 >> skip));
+    qDebug() << "Camera resolution" << m_size;
+  }
+}
+
+// Remote control packets are a command character followed by a float
+void AiboSimulator::readControl()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  int port = socket->property("port").toInt();
+
+  while (socket->bytesAvailable() >= 5) {
+    char packet[5];
+    socket->read(packet, 5);
+    float amount;
+    memcpy(&amount, packet + 1, 4);
+    m_controlPackets++;
+    if (m_verbose) {
+      qDebug() << (port == Aibo::HeadRemoteControl ? "Head" : "Walk") << packet[0] << amount;
+    }
+  }
+}
+
+const QByteArray& AiboSimulator::jpeg(int index)
+{
+  QMap<int, QByteArray>::iterator encoded = m_encoded.find(index);
+  if (encoded == m_encoded.end()) {
+    QImage scaled = m_images.at(index).scaled(m_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    scaled.save(&buffer, "JPG", m_quality);
+    encoded = m_encoded.insert(index, data);
+  }
+  return encoded.value();
+}
+
+void AiboSimulator::sendFrame()
+{
+  if (m_cameraClients.isEmpty()) {
+    return;
+  }
+
+  QByteArray frame;
+  if (!m_recording.isEmpty()) {
+    CameraPacket packet = m_recording.at(m_frameNumber % m_recording.size());
+    packet.timestamp = m_clock.elapsed();
+    packet.frameNumber = m_frameNumber;
+    frame = CameraStream::encode(packet);
+  } else if (!m_images.isEmpty()) {
+    CameraPacket packet;
+    packet.width = m_size.width();
+    packet.height = m_size.height();
+    packet.timestamp = m_clock.elapsed();
+    packet.frameNumber = m_frameNumber;
+    packet.data = jpeg(m_frameNumber % m_images.size());
+    frame = CameraStream::encode(packet);
+  } else {
+    return;
+  }
+  m_frameNumber++;
+
+  foreach (QTcpSocket *socket, m_cameraClients) {
+    // Like the robot, skip frames for a client that can't keep up rather
+    // than queueing them
+    if (socket->bytesToWrite() > frame.size()) {
+      m_framesSkipped++;
+      continue;
+    }
+    socket->write(frame);
+    m_framesSent++;
+    m_bytesSent += frame.size();
+  }
+}
+
+void AiboSimulator::printStats()
+{
+  if (m_framesSent == 0 && m_framesSkipped == 0 && m_controlPackets == 0) {
+    return;
+  }
+  qDebug() << "Sent" << m_framesSent << "frames," << m_bytesSent/1024 << "kB, skipped" << m_framesSkipped
+           << "and received" << m_controlPackets << "control packets in" << m_statsTimer.interval()/1000 << "s";
+  m_framesSent = 0;
+  m_framesSkipped = 0;
+  m_bytesSent = 0;
+  m_controlPackets = 0;
+}
+
+
+typedef struct s_popts {
+  string images;
+  string recording;
+  int fps;
+  int width;
+  int height;
+  int quality;
+  bool verbose;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  AiboSimulator simulator;
+  simulator.setFrameRate(popts.fps);
+  simulator.setResolution(QSize(popts.width, popts.height));
+  simulator.setQuality(popts.quality);
+  simulator.setVerbose(popts.verbose);
+
+  int frames;
+  if (!popts.recording.empty()) {
+    frames = simulator.loadRecording(QString::fromStdString(popts.recording));
+  } else {
+    frames = simulator.loadImages(QString::fromStdString(popts.images));
+  }
+  if (frames == 0) {
+    std::cerr << "No frames to stream" << std::endl;
+    return 1;
+  }
+  std::cout << "Streaming " << frames << " frames at " << popts.fps << " fps" << std::endl;
+
+  if (!simulator.listen())
+    return 1;
+
+  return app.exec();
+};
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("images,i", po::value<string>(&popts.images)->default_value("images"), "Directory of images to stream")
+     ("recording,r", po::value<string>(&popts.recording), "Stream the images of a saved raw camera stream instead")
+     ("fps,f", po::value<int>(&popts.fps)->default_value(20), "Frames sent per second")
+     ("width,W", po::value<int>(&popts.width)->default_value(208), "Frame width until a client picks a resolution")
+     ("height,H", po::value<int>(&popts.height)->default_value(160), "Frame height until a client picks a resolution")
+     ("quality,q", po::value<int>(&popts.quality)->default_value(85), "JPEG quality (0-100)")
+     ("verbose,v", "Log every head and walk control packet");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   popts.verbose = vm.count("verbose");
+   if (vm.count("help")){
+     std::cout << desc;
+           return false;
+   }
+   return true;
+}
@@ -0,0 +1,78 @@
+#ifndef AIBOSIM_H
+#define AIBOSIM_H
+
+#include <QObject>
+#include <QImage>
+#include <QList>
+#include <QMap>
+#include <QByteArray>
+#include <QString>
+#include <QSize>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include <libaibo/camerastream.h>
+
+class QTcpServer;
+class QTcpSocket;
+
+/**
+    Stands in for the Tekkotsu servers on an Aibo so that libaibo can be
+    run and benchmarked without the robot. Commands on MainControl and
+    packets on the head, walk and emergency stop ports are logged. Every
+    client of RawCamServer gets a stream of JPEG frames at a fixed rate,
+    cycling through a set of images or a recorded camera stream.
+*/
+class AiboSimulator : public QObject {
+  Q_OBJECT
+  public:
+    AiboSimulator(QObject *parent = 0);
+    ~AiboSimulator();
+
+    /** Loads every image in a directory. Returns the number loaded */
+    int loadImages(const QString &directory);
+    /** Loads the images of a raw camera stream saved to a file */
+    int loadRecording(const QString &fileName);
+
+    void setFrameRate(int fps);
+    void setResolution(const QSize &size); /**< Overridden by vision.rawcam_y_skip */
+    void setQuality(int quality); /**< JPEG quality, 0-100 */
+    void setVerbose(bool verbose); /**< Log every control packet, not just commands */
+
+    /** Starts listening on the Aibo ports. Returns false if one is taken */
+    bool listen();
+
+  private slots:
+    void acceptConnection();
+    void readMain();
+    void readControl();
+    void clientDisconnected();
+    void sendFrame();
+    void printStats();
+
+  private:
+    void handleCommand(const QString &command);
+    const QByteArray& jpeg(int index);
+
+    QMap<QTcpServer*, int> m_servers; // server to port
+    QList<QTcpSocket*> m_cameraClients;
+
+    QList<QImage> m_images;
+    QList<CameraPacket> m_recording;
+    QMap<int, QByteArray> m_encoded; // JPEGs of m_images at m_size
+
+    QSize m_size;
+    int m_quality;
+    bool m_verbose;
+
+    QTimer m_frameTimer;
+    QTimer m_statsTimer;
+    QElapsedTimer m_clock;
+    int m_frameNumber;
+    int m_framesSent;
+    int m_framesSkipped;
+    qint64 m_bytesSent;
+    int m_controlPackets;
+};
+
+#endif //AIBOSIM_H
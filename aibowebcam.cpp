@@ -1,5 +1,10 @@
 #include "gngviewer.h"
 #include "libgng/gng.h"
+#include "libgng/checkpoint.h"
+#include "libgng/journal.h"
+#include "libgng/stepprofile.h"
+#include "libgng/metricsserver.h"
+#include "libaibo/trace.h"
 #include "libgng/imagesource.h"
 #include "libgng/node.h"
 
@@ -15,6 +20,9 @@
 #include <QApplication>
 #include <QDebug>
 #include "libgng/camerasource.h"
+#include "libgng/recordingsource.h"
+#include "libgng/replaysource.h"
+#include <QDateTime>
 //#include "ui_viewer.h"
 
 namespace po=boost::program_options;
@@ -36,6 +44,21 @@ typedef struct s_popts {
   float errorReduction;
   float insertErrorReduction;
   int totalIterations;
+  string loadModel;
+  string saveModel;
+  string journal;
+  bool profile;
+  bool greedySearch;
+  int metricsPort;
+  string trace;
+  string initModel;
+  int initEdgeAge;
+  int focusSteps;
+  float focusGain;
+  uint seed;
+  string recordSamples;
+  string replaySamples;
+  bool replayRealTime;
 } ProgOpts;
 
 bool parse_args(int argc, char* argv[], ProgOpts& popts);
@@ -46,6 +69,11 @@ int main(int argc, char* argv[]) {
         if(!parse_args(argc, argv, popts))
           exit(1);
 
+        // Before any thread to trace is started
+        if (!popts.trace.empty()) {
+          Trace::start();
+        }
+
   // Create our QApplication object. Needed for the gui and for threading
   QApplication app(argc, argv);
  
@@ -54,11 +82,34 @@ int main(int argc, char* argv[]) {
 //   ui.setupUi(&w);
 //   w.show();
 
+  // A replay reuses the seed of its recording, so the GNG's random start
+  // and everything after it repeat the recorded run
+  ReplaySource replay(QString::fromStdString(popts.replaySamples));
+  if (!popts.replaySamples.empty()) {
+    if (!replay.open()) {
+      exit(1);
+    }
+    replay.setRealTime(popts.replayRealTime);
+    popts.seed = replay.seed();
+  }
+  if (popts.seed == 0) {
+    popts.seed = QDateTime::currentMSecsSinceEpoch();
+  }
+  qDebug() << "Random seed" << popts.seed;
+  qsrand(popts.seed);
+
   // Create the GNG object with bounds of 0 and 1.
   GrowingNeuralGas gng(5);
 
-  AiboSource aibo(QString::fromStdString(popts.hostname));
-  AiboFocus aibofocus(&gng, &aibo);
+  // A replay can still move the head, but doesn't need the robot
+  AiboSource *aibo = 0;
+  AiboFocus *aibofocus = 0;
+  if (!popts.hostname.empty()) {
+    aibo = new AiboSource(QString::fromStdString(popts.hostname));
+    aibofocus = new AiboFocus(&gng, aibo);
+    aibofocus->setStepInterval(popts.focusSteps);
+    aibofocus->setGain(popts.focusGain);
+  }
 
   // set command-line parameters
   gng.setDelay(popts.delay);
@@ -72,29 +123,100 @@ int main(int argc, char* argv[]) {
   gng.setInsertErrorReduction(popts.insertErrorReduction);
   gng.setUpdateInterval(popts.updateInterval);
 
-  CameraSource source;
-  source.start();
-  qDebug() << "Creating view with width and height" << source.width() << source.height();
   GngViewer view;
-  view.setSize(source.width(), source.height());
+  PointSource *source = &replay;
+  int width = replay.width();
+  int height = replay.height();
+
+  // The webcam is only opened when not replaying
+  CameraSource *camera = 0;
+  if (popts.replaySamples.empty()) {
+    camera = new CameraSource;
+    camera->start();
+    view.setSource(camera);
+    source = camera;
+    width = camera->width();
+    height = camera->height();
+  }
+  qDebug() << "Creating view with width and height" << width << height;
+  view.setSize(width, height);
   
   // Give the view a gng to visualize.
   view.setGng(&gng);
   view.show();
-    
-  view.setSource(&source);
+
+  RecordingSource recording(source, QString::fromStdString(popts.recordSamples));
+  if (!popts.recordSamples.empty()) {
+    if (!recording.open(popts.seed, width, height)) {
+      exit(1);
+    }
+    source = &recording;
+  }
   
   // Give the GNG its way of generating points
-  gng.setPointGenerator(&source);
+  gng.setPointGenerator(source);
+
+  // Pick up a saved network. The parameters come from the command line,
+  // so only the network is restored
+  if (!popts.loadModel.empty()
+      && !Checkpoint::load(&gng, QString::fromStdString(popts.loadModel), Checkpoint::Network)) {
+    exit(1);
+  }
+  // Or start over from a network trained on a similar scene
+  if (!popts.initModel.empty()
+      && !gng.loadInitialNetwork(QString::fromStdString(popts.initModel), popts.initEdgeAge)) {
+    exit(1);
+  }
+
+  // Attached after loading, so the journal starts from the loaded network
+  Journal journal(QString::fromStdString(popts.journal), 5);
+  if (!popts.journal.empty()) {
+    if (!journal.open()) {
+      exit(1);
+    }
+    gng.setJournal(&journal);
+  }
+  gng.setProfiling(popts.profile);
+  gng.setGreedySearch(popts.greedySearch);
+
+  MetricsServer metrics;
+  metrics.setGng(&gng);
+  metrics.setCamera(camera);
+  metrics.setAibo(aibo);
+  if (popts.metricsPort > 0 && !metrics.listen(popts.metricsPort)) {
+    exit(1);
+  }
 
   // Run the GNG during idle processing for 10,000 cycles
-  gng.stopAt(popts.totalIterations);
+  gng.stopAt(gng.currentStep() + popts.totalIterations);
   gng.start();
 
-  aibofocus.setColor(QColor(Qt::black));
+  if (aibofocus) {
+    aibofocus->setColor(QColor(Qt::black));
+  }
  
   // Execute the Qt mainloop. Needed for widgets to update themselves/for events to happen
   app.exec();
+
+  if (gng.profile()) {
+    std::cout << gng.profile()->report().toStdString();
+  }
+  if (gng.greedySearch()) {
+    std::cout << gng.greedyFallbacks() << " of " << gng.greedySearches() << " greedy winner searches fell back to the exact search, "
+              << gng.greedyAgreements() << " of " << gng.greedyAudits() << " checked found the exact winner and "
+              << gng.greedySecondAgreements() << " the exact second winner" << std::endl;
+  }
+  if (!popts.trace.empty()) {
+    Trace::save(QString::fromStdString(popts.trace));
+  }
+
+  if (!popts.saveModel.empty()) {
+    Checkpoint::save(gng, QString::fromStdString(popts.saveModel));
+  }
+  recording.close();
+  delete aibofocus;
+  delete aibo;
+  delete camera;
 }
 
 bool parse_args(int argc, char* argv[], ProgOpts& popts){
@@ -104,7 +226,7 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
      ("help,h", "Show this message")
      ("config,c", po::value<string>(&configFile), "Config file to read options from")
      ("delay,d", po::value<int>(&popts.delay)->default_value(1), "Add a n millisecond delay to each step.")
-     ("hostname,p", po::value<string>(&popts.hostname), "Aibo's Hostname")
+     ("hostname,p", po::value<string>(&popts.hostname), "Aibo's Hostname. Only optional with --replaySamples")
      ("updateInterval,u", po::value<int>(&popts.updateInterval)->default_value(50), "Emit signal updated() once per this number of steps")
      ("winnerLearnRate,w", po::value<float>(&popts.winnerLearnRate)->default_value(0.1), "Used to adjust closest unit towards input point")
      ("neighborLearnRate,n", po::value<float>(&popts.neighborLearnRate)->default_value(0.01), "Used to adjust other neighbors towards input point")
@@ -114,7 +236,22 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
      ("targetError,e", po::value<float>(&popts.targetError)->default_value(0.001), "Continue inserting nodes until the average error has reached this threshold")
      ("errorReduction,r", po::value<float>(&popts.errorReduction)->default_value(0.1), "All errors are reduced by this amount each GNG step")
      ("insertErrorReduction,s", po::value<float>(&popts.insertErrorReduction)->default_value(0.5), "Reduce new unit's error by this much")
-     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total");
+     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total")
+     ("loadModel", po::value<string>(&popts.loadModel), "Continue training the network saved in this checkpoint")
+     ("saveModel", po::value<string>(&popts.saveModel), "Save the network to this checkpoint on exit")
+     ("journal", po::value<string>(&popts.journal), "Record every change to the network to this file, for gng-replay")
+     ("profile", "Time every phase of the GNG step and print a report on exit. Needs a GNG_PROFILING build")
+     ("greedySearch", "Find the winners by walking the edges from the last winner instead of measuring every node")
+     ("metricsPort", po::value<int>(&popts.metricsPort)->default_value(0), "Serve live metrics for Prometheus on this localhost port, 0 for none")
+     ("trace", po::value<string>(&popts.trace), "Record a timeline of every thread to this file, in Chrome trace_event JSON for chrome://tracing or Perfetto. Keeps the last 262144 events of each thread")
+     ("initModel", po::value<string>(&popts.initModel), "Start from the network saved in this checkpoint instead of two random nodes")
+     ("initEdgeAge", po::value<int>(&popts.initEdgeAge)->default_value(-1), "Age given to every edge of the initial network, -1 keeps the saved ages. Near maxEdgeAge, edges the scene no longer has are pruned quickly")
+     ("focusSteps", po::value<int>(&popts.focusSteps)->default_value(500), "Move the head every this many steps, 0 on every Aibo camera frame")
+     ("focusGain", po::value<float>(&popts.focusGain)->default_value(0.5), "Fraction of the target's offset from the image center corrected per head move")
+     ("seed", po::value<uint>(&popts.seed)->default_value(0), "Seed for the random number generator. 0 picks one and prints it")
+     ("recordSamples", po::value<string>(&popts.recordSamples), "Record every sampled point to this file, for --replaySamples")
+     ("replaySamples", po::value<string>(&popts.replaySamples), "Train on the points recorded with --recordSamples instead of the webcam")
+     ("replayRealTime", "Replay the points with their recorded timing instead of as fast as possible");
    po::variables_map vm;
    po::store(po::parse_command_line(argc, argv, desc), vm);
    po::notify(vm);
@@ -125,9 +262,12 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
    }
    po::store(po::parse_command_line(argc, argv, desc), vm);
    po::notify(vm);
-   if (vm.count("help") || !vm.count("hostname")) {
+   if (vm.count("help") || (!vm.count("hostname") && !vm.count("replaySamples"))) {
      std::cout << desc;
            return false;
    }
+   popts.replayRealTime = vm.count("replayRealTime");
+   popts.profile = vm.count("profile");
+   popts.greedySearch = vm.count("greedySearch");
    return true;
 }
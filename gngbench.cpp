@@ -0,0 +1,711 @@
+// Times the pieces of a GNG step one at a time, and whole training runs on
+// the bundled images:
+//
+//   ./gng-bench --json baseline.json
+//   ./gng-bench --baseline baseline.json     (after a change)
+//
+// The scaling benchmarks train on generated distributions, see
+// SyntheticSource, from networks of up to 100k nodes.
+//
+// Every benchmark is warmed up and then repeated. ns/op is the median over
+// the repetitions, reported with the fastest one and the spread. With
+// --baseline the medians are compared to a file written by --json, and the
+// exit code is 1 if anything got slower by more than --threshold percent.
+
+#include "libgng/gng.h"
+#include "libgng/node.h"
+#include "libgng/point.h"
+#include "libgng/imagesource.h"
+#include "libgng/syntheticsource.h"
+#include "libgng/labelmap.h"
+#include "libgng/clock.h"
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QRegExp>
+#include <QHash>
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+namespace po=boost::program_options;
+using std::string;
+using namespace GNG;
+
+namespace GNG {
+
+  /** Reaches into GrowingNeuralGas for the steps that are private */
+  class Benchmark {
+    public:
+      /** Replaces the network with nodes random nodes, connected in
+          chains of subgraphSize */
+      static void setNetwork(GrowingNeuralGas *gng, int nodes, int subgraphSize)
+      {
+        gng->clearNetwork();
+        for (int i=0; i<nodes; i++) {
+          gng->m_nodes.append(new Node(Point(), gng->m_dimension, gng->m_min, gng->m_max));
+          if (i % subgraphSize != 0) {
+            gng->connectNodes(gng->m_nodes[i-1], gng->m_nodes[i]);
+          }
+        }
+      }
+      /** Replaces the network with nodes random nodes, each connected
+          to its neighbors nearest nodes, like a trained network */
+      static void setProximityNetwork(GrowingNeuralGas *gng, int nodes, int neighbors)
+      {
+        setNetwork(gng, nodes, 1);
+        QList<Node*> all = gng->m_nodes;
+        foreach (Node *node, all) {
+          QList<QPair<qreal, Node*> > distances;
+          foreach (Node *other, all) {
+            if (other != node) {
+              distances.append(qMakePair(node->location().distanceTo(other->location()), other));
+            }
+          }
+          qSort(distances);
+          for (int i=0; i<neighbors && i<distances.size(); i++) {
+            if (!node->hasEdgeTo(distances[i].second)) {
+              gng->connectNodes(node, distances[i].second);
+            }
+          }
+        }
+      }
+      static NodePair exactWinners(GrowingNeuralGas *gng, const Point &point)
+      {
+        return gng->exactWinners(point);
+      }
+      static NodePair computeDistances(GrowingNeuralGas *gng, const Point &point)
+      {
+        return gng->computeDistances(point);
+      }
+      static void removeOldEdges(GrowingNeuralGas *gng)
+      {
+        gng->removeOldEdges();
+      }
+      static void runSingleStep(GrowingNeuralGas *gng)
+      {
+        gng->runSingleStep();
+      }
+  };
+
+}
+
+// Results go here so the compiler can't drop the work
+static volatile qreal sink;
+
+static const int PointCount = 1024; // a power of 2
+
+static QVector<Point> randomPoints(int dimension)
+{
+  QVector<Point> points;
+  for (int i=0; i<PointCount; i++) {
+    points.append(Node(Point(), dimension).location());
+  }
+  return points;
+}
+
+/** One thing to time */
+class BenchmarkCase {
+  public:
+    BenchmarkCase(const QString &name) : m_name(name) {}
+    virtual ~BenchmarkCase() {}
+
+    QString name() const { return m_name; }
+    /** Builds the network or whatever else the case works on. Runs once,
+        untimed, before the first repetition, so cases left out by
+        --filter cost nothing */
+    virtual void prepare() {}
+    /** Runs before every repetition, untimed */
+    virtual void setUp() {}
+    /** Does the operation iterations times */
+    virtual void run(int iterations) = 0;
+    /** Operations per repetition, 0 to fit as many as --minTime allows */
+    virtual int fixedIterations() const { return 0; }
+    /** What an operation is, in the report */
+    virtual const char* unit() const { return "op"; }
+    /** Anything else to report, after the timing */
+    virtual QString note() { return QString(); }
+
+  private:
+    QString m_name;
+};
+
+class DistanceCase : public BenchmarkCase {
+  public:
+    DistanceCase() : BenchmarkCase("Point::distanceTo") {}
+    virtual void prepare()
+    {
+      m_points = randomPoints(5);
+    }
+    virtual void run(int iterations)
+    {
+      qreal sum = 0;
+      for (int i=0; i<iterations; i++) {
+        sum += m_points[i & (PointCount-1)].distanceTo(m_points[(i+1) & (PointCount-1)]);
+      }
+      sink = sum;
+    }
+  private:
+    QVector<Point> m_points;
+};
+
+class ComputeDistancesCase : public BenchmarkCase {
+  public:
+    ComputeDistancesCase(int nodes)
+      : BenchmarkCase(QString("computeDistances/%1").arg(nodes)),
+        m_nodes(nodes),
+        m_gng(5) {}
+    virtual void prepare()
+    {
+      m_points = randomPoints(5);
+      Benchmark::setNetwork(&m_gng, m_nodes, 10);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        sink = Benchmark::computeDistances(&m_gng, m_points[i & (PointCount-1)]).first->error();
+      }
+    }
+  private:
+    int m_nodes;
+    GrowingNeuralGas m_gng;
+    QVector<Point> m_points;
+};
+
+// No edge is old enough to go, so this times the scan every step does
+class RemoveOldEdgesCase : public BenchmarkCase {
+  public:
+    RemoveOldEdgesCase(int nodes)
+      : BenchmarkCase(QString("removeOldEdges/%1").arg(nodes)),
+        m_nodes(nodes),
+        m_gng(5) {}
+    virtual void prepare()
+    {
+      Benchmark::setNetwork(&m_gng, m_nodes, 10);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        Benchmark::removeOldEdges(&m_gng);
+      }
+    }
+  private:
+    int m_nodes;
+    GrowingNeuralGas m_gng;
+};
+
+class GenerateSubgraphsCase : public BenchmarkCase {
+  public:
+    GenerateSubgraphsCase(int nodes)
+      : BenchmarkCase(QString("generateSubgraphs/%1").arg(nodes)),
+        m_nodes(nodes),
+        m_gng(5) {}
+    virtual void prepare()
+    {
+      Benchmark::setNetwork(&m_gng, m_nodes, 10);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        m_gng.generateSubgraphs();
+      }
+    }
+  private:
+    int m_nodes;
+    GrowingNeuralGas m_gng;
+};
+
+class GeneratePointCase : public BenchmarkCase {
+  public:
+    GeneratePointCase(const QString &fileName, const QImage &image)
+      : BenchmarkCase("ImageSource::generatePoint/" + fileName),
+        m_image(image),
+        m_source(0) {}
+    ~GeneratePointCase()
+    {
+      delete m_source;
+    }
+    virtual void prepare()
+    {
+      m_source = new ImageSource(m_image);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        sink = m_source->generatePoint()[0];
+      }
+    }
+  private:
+    QImage m_image;
+    ImageSource *m_source;
+};
+
+// A training run from two nodes, so every repetition starts over
+class StepCase : public BenchmarkCase {
+  public:
+    StepCase(const QString &fileName, const QImage &image, int steps)
+      : BenchmarkCase("runSingleStep/" + fileName),
+        m_image(image),
+        m_steps(steps),
+        m_gng(0),
+        m_source(0) {}
+    ~StepCase()
+    {
+      delete m_gng;
+      delete m_source;
+    }
+    virtual void setUp()
+    {
+      delete m_gng;
+      delete m_source;
+      m_source = new ImageSource(m_image);
+      m_gng = new GrowingNeuralGas(5);
+      m_gng->setPointGenerator(m_source);
+      m_gng->setUpdateInterval(0);
+      m_gng->stopAt(-1);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        Benchmark::runSingleStep(m_gng);
+      }
+    }
+    virtual int fixedIterations() const { return m_steps; }
+    virtual const char* unit() const { return "step"; }
+  private:
+    QImage m_image;
+    int m_steps;
+    GrowingNeuralGas *m_gng;
+    ImageSource *m_source;
+};
+
+// Segmenting a 640x480 frame with the network
+class LabelMapCase : public BenchmarkCase {
+  public:
+    LabelMapCase(const QString &fileName, const QImage &image, int nodes)
+      : BenchmarkCase(QString("LabelMap::label/%1/%2").arg(fileName).arg(nodes)),
+        m_image(image),
+        m_nodes(nodes),
+        m_gng(5) {}
+    virtual void prepare()
+    {
+      m_frame.convert(m_image.scaled(640, 480));
+      Benchmark::setNetwork(&m_gng, m_nodes, 10);
+      m_gng.generateSubgraphs();
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        m_labels.label(m_frame, m_gng);
+      }
+      sink = m_labels.pixelCounts().value(0);
+    }
+    virtual const char* unit() const { return "frame"; }
+  private:
+    QImage m_image;
+    int m_nodes;
+    GrowingNeuralGas m_gng;
+    HslImage m_frame;
+    LabelMap m_labels;
+};
+
+// Winner search on samples that move a little at a time, like
+// consecutive samples from a camera, exact or walking the edges
+class WinnerSearchCase : public BenchmarkCase {
+  public:
+    WinnerSearchCase(bool greedy, int nodes)
+      : BenchmarkCase(QString("winnerSearch/%1/%2").arg(greedy ? "greedy" : "exact").arg(nodes)),
+        m_nodes(nodes),
+        m_gng(5)
+    {
+      m_gng.setGreedySearch(greedy);
+    }
+    virtual void prepare()
+    {
+      Benchmark::setProximityNetwork(&m_gng, m_nodes, 6);
+      Point point = randomPoints(5).first();
+      for (int i=0; i<PointCount; i++) {
+        for (int j=0; j<point.size(); j++) {
+          point[j] = qBound(qreal(0), point[j] + 0.02*(qreal(qrand())/RAND_MAX - 0.5), qreal(1));
+        }
+        m_points.append(point);
+      }
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        sink = Benchmark::computeDistances(&m_gng, m_points[i & (PointCount-1)]).first->error();
+      }
+    }
+    virtual QString note()
+    {
+      if (!m_gng.greedySearch()) {
+        return QString();
+      }
+      int agreed = 0;
+      int secondAgreed = 0;
+      int fallbacks = m_gng.greedyFallbacks();
+      for (int i=0; i<PointCount; i++) {
+        NodePair greedy = Benchmark::computeDistances(&m_gng, m_points[i]);
+        NodePair exact = Benchmark::exactWinners(&m_gng, m_points[i]);
+        agreed += greedy.first == exact.first;
+        secondAgreed += greedy.second == exact.second;
+      }
+      return QString("same winner %1%, same second winner %2%, %3% exact fallbacks")
+        .arg(100.0*agreed/PointCount, 0, 'f', 1)
+        .arg(100.0*secondAgreed/PointCount, 0, 'f', 1)
+        .arg(100.0*(m_gng.greedyFallbacks() - fallbacks)/PointCount, 0, 'f', 1);
+    }
+  private:
+    int m_nodes;
+    GrowingNeuralGas m_gng;
+    QVector<Point> m_points;
+};
+
+static const char *sourceNames[] = { "uniform", "mixture", "blobs", "drifting" };
+
+static PointSource* createSource(const QString &name, int dimension)
+{
+  if (name == "uniform") {
+    return new UniformSource(dimension);
+  } else if (name == "mixture") {
+    return new GaussianMixtureSource(dimension, 20);
+  } else if (name == "blobs") {
+    return new BlobSource(dimension, 20);
+  } else {
+    return new DriftingMixtureSource(dimension, 20);
+  }
+}
+
+class SyntheticPointCase : public BenchmarkCase {
+  public:
+    SyntheticPointCase(const QString &sourceName, int dimension)
+      : BenchmarkCase("SyntheticSource::generatePoint/" + sourceName),
+        m_sourceName(sourceName),
+        m_dimension(dimension),
+        m_source(0) {}
+    ~SyntheticPointCase()
+    {
+      delete m_source;
+    }
+    virtual void prepare()
+    {
+      m_source = createSource(m_sourceName, m_dimension);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        sink = m_source->generatePoint()[0];
+      }
+    }
+  private:
+    QString m_sourceName;
+    int m_dimension;
+    PointSource *m_source;
+};
+
+// Steps on a network that already has nodes nodes, to see how a step
+// scales with the size of the network
+class ScalingCase : public BenchmarkCase {
+  public:
+    ScalingCase(const QString &sourceName, int dimension, int nodes)
+      : BenchmarkCase(QString("scaling/%1/%2").arg(sourceName).arg(nodes)),
+        m_sourceName(sourceName),
+        m_dimension(dimension),
+        m_nodes(nodes),
+        m_gng(0),
+        m_source(0) {}
+    ~ScalingCase()
+    {
+      delete m_gng;
+      delete m_source;
+    }
+    virtual void setUp()
+    {
+      delete m_gng;
+      delete m_source;
+      m_source = createSource(m_sourceName, m_dimension);
+      m_gng = new GrowingNeuralGas(m_dimension);
+      Benchmark::setNetwork(m_gng, m_nodes, 10);
+      m_gng->setPointGenerator(m_source);
+      m_gng->setUpdateInterval(0);
+      m_gng->stopAt(-1);
+    }
+    virtual void run(int iterations)
+    {
+      for (int i=0; i<iterations; i++) {
+        Benchmark::runSingleStep(m_gng);
+      }
+    }
+    virtual const char* unit() const { return "step"; }
+  private:
+    QString m_sourceName;
+    int m_dimension;
+    int m_nodes;
+    GrowingNeuralGas *m_gng;
+    PointSource *m_source;
+};
+
+
+typedef struct s_popts {
+  string filter;
+  string images;
+  int warmup;
+  int repetitions;
+  int minTime;
+  int steps;
+  int dimension;
+  string json;
+  string baseline;
+  qreal threshold;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+struct Result {
+  QString name;
+  QString unit;
+  int iterations;
+  QVector<qreal> nanosPerOp; // one per repetition, sorted
+
+  qreal median() const { return nanosPerOp[nanosPerOp.size()/2]; }
+  qreal minimum() const { return nanosPerOp.first(); }
+  qreal mean() const
+  {
+    qreal sum = 0;
+    foreach (qreal value, nanosPerOp) {
+      sum += value;
+    }
+    return sum / nanosPerOp.size();
+  }
+  qreal deviation() const
+  {
+    qreal average = mean();
+    qreal sum = 0;
+    foreach (qreal value, nanosPerOp) {
+      sum += (value - average)*(value - average);
+    }
+    return sqrt(sum / nanosPerOp.size());
+  }
+};
+
+static qint64 timeRun(BenchmarkCase *benchmark, int iterations)
+{
+  benchmark->setUp();
+  qint64 start = monotonicTime();
+  benchmark->run(iterations);
+  return monotonicTime() - start;
+}
+
+static Result measure(BenchmarkCase *benchmark, const ProgOpts &popts)
+{
+  Result result;
+  result.name = benchmark->name();
+  result.unit = benchmark->unit();
+
+  // Seeded by name, so a case gets the same network whichever others
+  // --filter lets run before it
+  qsrand(qHash(benchmark->name()));
+  benchmark->prepare();
+
+  // Double the iterations until a repetition takes --minTime
+  int iterations = benchmark->fixedIterations();
+  if (iterations == 0) {
+    qint64 target = qint64(popts.minTime) * 1000000;
+    iterations = 1;
+    qint64 elapsed = timeRun(benchmark, iterations);
+    while (elapsed < target && iterations < (1 << 30)) {
+      iterations = elapsed > 0 ? qMin(qint64(1) << 30, qMax(qint64(2)*iterations, iterations*target/elapsed)) : 2*iterations;
+      elapsed = timeRun(benchmark, iterations);
+    }
+  }
+  result.iterations = iterations;
+
+  for (int i=0; i<popts.warmup; i++) {
+    timeRun(benchmark, iterations);
+  }
+  for (int i=0; i<popts.repetitions; i++) {
+    result.nanosPerOp.append(qreal(timeRun(benchmark, iterations)) / iterations);
+  }
+  qSort(result.nanosPerOp);
+  return result;
+}
+
+// One benchmark per line, so the baseline can be read back line by line
+static bool writeJson(const QString &fileName, const QList<Result> &results)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    std::cerr << "Could not write " << fileName.toStdString() << std::endl;
+    return false;
+  }
+  QTextStream out(&file);
+  out << "{\"benchmarks\": [\n";
+  for (int i=0; i<results.size(); i++) {
+    const Result &result = results[i];
+    out << QString("  {\"name\": \"%1\", \"unit\": \"%2\", \"iterations\": %3, \"repetitions\": %4, "
+                   "\"median_ns\": %5, \"min_ns\": %6, \"mean_ns\": %7, \"stddev_ns\": %8, \"per_second\": %9}")
+      .arg(result.name).arg(result.unit).arg(result.iterations).arg(result.nanosPerOp.size())
+      .arg(result.median(), 0, 'f', 3).arg(result.minimum(), 0, 'f', 3)
+      .arg(result.mean(), 0, 'f', 3).arg(result.deviation(), 0, 'f', 3)
+      .arg(1e9 / result.median(), 0, 'f', 1)
+        << (i+1 < results.size() ? ",\n" : "\n");
+  }
+  out << "]}\n";
+  return true;
+}
+
+static QHash<QString, qreal> readBaseline(const QString &fileName)
+{
+  QHash<QString, qreal> medians;
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    std::cerr << "Could not read " << fileName.toStdString() << std::endl;
+    return medians;
+  }
+  QRegExp entry("\"name\": \"([^\"]+)\".*\"median_ns\": ([-0-9.eE+]+)");
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    if (entry.indexIn(in.readLine()) >= 0) {
+      medians.insert(entry.cap(1), entry.cap(2).toDouble());
+    }
+  }
+  return medians;
+}
+
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  QList<BenchmarkCase*> benchmarks;
+  benchmarks << new DistanceCase;
+  benchmarks << new ComputeDistancesCase(100) << new ComputeDistancesCase(1000)
+             << new ComputeDistancesCase(10000) << new ComputeDistancesCase(100000);
+  benchmarks << new RemoveOldEdgesCase(1000) << new RemoveOldEdgesCase(10000);
+  benchmarks << new GenerateSubgraphsCase(1000) << new GenerateSubgraphsCase(10000);
+  for (int nodes=1000; nodes<=4000; nodes*=4) {
+    benchmarks << new WinnerSearchCase(false, nodes) << new WinnerSearchCase(true, nodes);
+  }
+
+  QDir images(QString::fromStdString(popts.images));
+  QStringList imageNames = images.entryList(QStringList() << "*.png" << "*.jpg", QDir::Files, QDir::Name);
+  if (imageNames.isEmpty()) {
+    std::cerr << "No images in " << popts.images << ", skipping the image benchmarks" << std::endl;
+  }
+  foreach (QString imageName, imageNames) {
+    QImage image(images.filePath(imageName));
+    if (image.isNull()) {
+      std::cerr << "Could not load " << imageName.toStdString() << std::endl;
+      continue;
+    }
+    benchmarks << new GeneratePointCase(imageName, image);
+    benchmarks << new StepCase(imageName, image, popts.steps);
+    benchmarks << new LabelMapCase(imageName, image, 1000);
+  }
+
+  for (int i=0; i<4; i++) {
+    benchmarks << new SyntheticPointCase(sourceNames[i], popts.dimension);
+  }
+  for (int i=0; i<4; i++) {
+    for (int nodes=1000; nodes<=100000; nodes*=10) {
+      benchmarks << new ScalingCase(sourceNames[i], popts.dimension, nodes);
+    }
+  }
+
+  QHash<QString, qreal> baseline;
+  if (!popts.baseline.empty()) {
+    baseline = readBaseline(QString::fromStdString(popts.baseline));
+  }
+
+  QList<Result> results;
+  int regressions = 0;
+  printf("%-40s %14s %14s %8s %14s\n", "benchmark", "median ns", "min ns", "spread", "per second");
+  foreach (BenchmarkCase *benchmark, benchmarks) {
+    if (!benchmark->name().contains(QString::fromStdString(popts.filter))) {
+      continue;
+    }
+    Result result = measure(benchmark, popts);
+    results.append(result);
+
+    printf("%-40s %11.1f/%-2s %14.1f %7.1f%% %14.0f",
+           result.name.toLocal8Bit().constData(), result.median(), benchmark->unit(),
+           result.minimum(), 100 * result.deviation() / result.mean(), 1e9 / result.median());
+    if (baseline.contains(result.name)) {
+      qreal change = 100 * (result.median() - baseline[result.name]) / baseline[result.name];
+      printf("  %+6.1f%%", change);
+      if (change > popts.threshold) {
+        printf(" REGRESSION");
+        regressions++;
+      } else if (change < -popts.threshold) {
+        printf(" faster");
+      }
+    } else if (!baseline.isEmpty()) {
+      printf("  new");
+    }
+    QString note = benchmark->note();
+    if (!note.isEmpty()) {
+      printf("  %s", note.toLocal8Bit().constData());
+    }
+    printf("\n");
+    fflush(stdout);
+  }
+  qDeleteAll(benchmarks);
+
+  if (!popts.json.empty() && !writeJson(QString::fromStdString(popts.json), results)) {
+    return 1;
+  }
+  if (regressions > 0) {
+    printf("%d benchmarks slower than the baseline by more than %.1f%%\n", regressions, popts.threshold);
+    return 1;
+  }
+  return 0;
+};
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("filter,f", po::value<string>(&popts.filter)->default_value(""), "Only run benchmarks whose name contains this")
+     ("images,i", po::value<string>(&popts.images)->default_value("images"), "Directory with the images to sample and train on")
+     ("warmup,w", po::value<int>(&popts.warmup)->default_value(2), "Untimed repetitions before measuring")
+     ("repetitions,r", po::value<int>(&popts.repetitions)->default_value(7), "Timed repetitions of every benchmark")
+     ("minTime", po::value<int>(&popts.minTime)->default_value(100), "Milliseconds a repetition runs for at least")
+     ("steps,s", po::value<int>(&popts.steps)->default_value(20000), "Steps of a runSingleStep training run")
+     ("dimension,d", po::value<int>(&popts.dimension)->default_value(5), "Dimension of the generated points in the synthetic and scaling benchmarks, at least 3")
+     ("json,j", po::value<string>(&popts.json), "Write the results to this file, to use as a baseline later")
+     ("baseline,b", po::value<string>(&popts.baseline), "Compare the results to this file from --json")
+     ("threshold,t", po::value<qreal>(&popts.threshold)->default_value(10), "Percent slower than the baseline that counts as a regression");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if (vm.count("help")){
+     std::cout << desc;
+           return false;
+   }
+   popts.repetitions = qMax(popts.repetitions, 1);
+   // The GNG's distance reads the hue at index 2
+   popts.dimension = qMax(popts.dimension, 3);
+   return true;
+}
@@ -0,0 +1,268 @@
+// Measures how fast the GNG learns, not just how fast it steps. Each run
+// trains on a source while the quantization error on a held-out set of
+// points is measured every --interval steps, and the report gives the
+// steps and seconds it took to get below each --thresholds error:
+//
+//   ./gng-converge --source mixture --steps 200000
+//   ./gng-converge --run default --run "slowInsert:nodeInsertionDelay=200"
+//   ./gng-converge -i ../images/desk-image.jpg --run flat --run "pyramid:pyramid=4"
+//
+// A run is a name and GrowingNeuralGas properties to set, so settings
+// and builds can be compared on the same input. On an image, pyramid=N
+// trains coarse to fine on N levels with a PyramidSchedule. The error is
+// always measured on pixels of the image itself.
+
+#include "gngconverge.h"
+
+#include <libgng/gng.h>
+#include <libgng/convergence.h>
+#include <libgng/imagesource.h>
+#include <libgng/pyramidschedule.h>
+#include <libgng/syntheticsource.h>
+#include <libgng/clock.h>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QStringList>
+#include <QVariant>
+#include <QImage>
+#include <QFile>
+#include <QTextStream>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <vector>
+
+namespace po=boost::program_options;
+using std::string;
+using std::vector;
+using namespace GNG;
+
+ConvergenceRun::ConvergenceRun(GrowingNeuralGas* gng, ConvergenceMonitor* monitor, int steps)
+  : m_gng(gng),
+    m_monitor(monitor),
+    m_steps(steps),
+    m_started(0),
+    m_measuring(0)
+{
+  connect(m_gng, SIGNAL(updated()), SLOT(measure()), Qt::DirectConnection);
+}
+
+void ConvergenceRun::start()
+{
+  m_gng->stopAt(m_steps);
+  m_measuring = 0;
+  m_started = monotonicTime();
+  m_monitor->record(*m_gng, 0);
+  m_measuring = monotonicTime() - m_started;
+  m_gng->start();
+}
+
+void ConvergenceRun::measure()
+{
+  qint64 now = monotonicTime();
+  const ConvergenceMonitor::Sample &sample = m_monitor->record(*m_gng, (now - m_started - m_measuring) / 1e9);
+  printf("step %8d  %8.2f s  %6d nodes  error %.6f\n", sample.step, sample.seconds, sample.nodes, sample.error);
+  fflush(stdout);
+  m_measuring += monotonicTime() - now;
+
+  if (m_gng->currentStep() >= m_steps) {
+    m_gng->stop();
+    emit finished();
+  }
+}
+
+
+typedef struct s_popts {
+  string source;
+  string image;
+  int dimension;
+  int clusters;
+  int heldOut;
+  int steps;
+  int interval;
+  string thresholds;
+  vector<string> runs;
+  int seed;
+  string csv;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+static PointSource* createSource(const ProgOpts &popts, quint32 seed)
+{
+  if (!popts.image.empty()) {
+    return new ImageSource(QImage(QString::fromStdString(popts.image)));
+  } else if (popts.source == "uniform") {
+    return new UniformSource(popts.dimension, seed);
+  } else if (popts.source == "blobs") {
+    return new BlobSource(popts.dimension, popts.clusters, 0.01, seed);
+  } else if (popts.source == "drifting") {
+    return new DriftingMixtureSource(popts.dimension, popts.clusters, 1e-5, 0.05, seed);
+  } else {
+    return new GaussianMixtureSource(popts.dimension, popts.clusters, 0.05, seed);
+  }
+}
+
+// "name:property=value,property=value", where pyramid is the levels of
+// the image pyramid rather than a property
+static bool applyRun(const QString &run, GrowingNeuralGas *gng, int *pyramidLevels)
+{
+  QStringList settings = run.section(':', 1).split(',', QString::SkipEmptyParts);
+  foreach (QString setting, settings) {
+    QString property = setting.section('=', 0, 0).trimmed();
+    QString value = setting.section('=', 1).trimmed();
+    if (property == "pyramid") {
+      *pyramidLevels = value.toInt();
+      continue;
+    }
+    if (gng->metaObject()->indexOfProperty(property.toLatin1().constData()) < 0
+        || !gng->setProperty(property.toLatin1().constData(), value)) {
+      std::cerr << "Can't set " << setting.toStdString() << " in run " << run.toStdString() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  QList<qreal> thresholds;
+  foreach (QString threshold, QString::fromStdString(popts.thresholds).split(',', QString::SkipEmptyParts)) {
+    thresholds.append(threshold.toDouble());
+  }
+
+  QStringList runNames;
+  QList<ConvergenceMonitor*> monitors;
+  QFile csvFile(QString::fromStdString(popts.csv));
+  QTextStream csv(&csvFile);
+  if (!popts.csv.empty()) {
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      std::cerr << "Could not write " << popts.csv << std::endl;
+      exit(1);
+    }
+    csv << "run,step,seconds,nodes,error\n";
+  }
+
+  foreach (string runSpec, popts.runs) {
+    QString run = QString::fromStdString(runSpec);
+    QString name = run.section(':', 0, 0);
+    printf("Run %s\n", name.toLocal8Bit().constData());
+
+    // The same held-out points, first nodes and training points every run.
+    // Held-out points come first, image sources draw with qrand()
+    qsrand(popts.seed + 1);
+    PointSource *heldOutSource = createSource(popts, popts.seed + 1);
+    ConvergenceMonitor *monitor = new ConvergenceMonitor(heldOutSource, popts.heldOut);
+    delete heldOutSource;
+
+    qsrand(popts.seed);
+    PointSource *source = createSource(popts, popts.seed);
+    GrowingNeuralGas gng(source->dimension());
+    gng.setPointGenerator(source);
+    gng.setUpdateInterval(popts.interval);
+    int pyramidLevels = 1;
+    if (!applyRun(run, &gng, &pyramidLevels)) {
+      exit(1);
+    }
+    ImageSource *imageSource = dynamic_cast<ImageSource*>(source);
+    if (pyramidLevels > 1 && !imageSource) {
+      std::cerr << "Run " << run.toStdString() << " needs an --image for its pyramid" << std::endl;
+      exit(1);
+    }
+    PyramidSchedule *pyramid = 0;
+    if (imageSource) {
+      imageSource->setPyramidLevels(pyramidLevels);
+      pyramid = new PyramidSchedule(&gng, imageSource);
+    }
+
+    QEventLoop loop;
+    ConvergenceRun convergence(&gng, monitor, popts.steps);
+    QObject::connect(&convergence, SIGNAL(finished()), &loop, SLOT(quit()));
+    convergence.start();
+    loop.exec();
+    delete pyramid;
+    delete source;
+
+    runNames.append(name);
+    monitors.append(monitor);
+    foreach (ConvergenceMonitor::Sample sample, monitor->samples()) {
+      if (!csvFile.isOpen()) {
+        break;
+      }
+      csv << name << "," << sample.step << "," << sample.seconds << ","
+          << sample.nodes << "," << sample.error << "\n";
+    }
+  }
+
+  // Steps and seconds to reach each threshold, per run
+  printf("\n%-20s", "error below");
+  foreach (qreal threshold, thresholds) {
+    printf(" %22g", threshold);
+  }
+  printf(" %12s\n", "final error");
+  for (int i=0; i<monitors.size(); i++) {
+    printf("%-20s", runNames[i].toLocal8Bit().constData());
+    foreach (qreal threshold, thresholds) {
+      const ConvergenceMonitor::Sample *reached = monitors[i]->reached(threshold);
+      if (reached) {
+        printf(" %9d st %8.2f s", reached->step, reached->seconds);
+      } else {
+        printf(" %22s", "not reached");
+      }
+    }
+    printf(" %12.6f\n", monitors[i]->samples().last().error);
+  }
+  qDeleteAll(monitors);
+  return 0;
+};
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("source", po::value<string>(&popts.source)->default_value("mixture"), "Generated input: uniform, mixture, blobs or drifting")
+     ("image,i", po::value<string>(&popts.image), "Train on this image instead of a generated source")
+     ("dimension,d", po::value<int>(&popts.dimension)->default_value(5), "Dimension of the generated points, at least 3")
+     ("clusters", po::value<int>(&popts.clusters)->default_value(20), "Clusters or blobs in the generated input")
+     ("heldOut", po::value<int>(&popts.heldOut)->default_value(10000), "Held-out points the error is measured on")
+     ("steps,s", po::value<int>(&popts.steps)->default_value(100000), "Steps to train every run for")
+     ("interval", po::value<int>(&popts.interval)->default_value(2000), "Measure the error every this many steps")
+     ("thresholds,t", po::value<string>(&popts.thresholds)->default_value("0.05,0.02,0.01,0.005"), "Comma separated errors to report the time to reach")
+     ("run,r", po::value<vector<string> >(&popts.runs), "A run to compare, \"name:property=value,...\" with GrowingNeuralGas properties. Repeat for several")
+     ("seed", po::value<int>(&popts.seed)->default_value(1), "Seed for the input, held-out points and first nodes")
+     ("csv", po::value<string>(&popts.csv), "Write every measurement to this file");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if (vm.count("help")){
+     std::cout << desc;
+           return false;
+   }
+   if (popts.runs.empty()) {
+     popts.runs.push_back("default");
+   }
+   popts.dimension = qMax(popts.dimension, 3);
+   popts.interval = qMax(popts.interval, 1);
+   // Runs end on a measurement
+   popts.steps = (qMax(popts.steps, 1) + popts.interval - 1) / popts.interval * popts.interval;
+   return true;
+}
@@ -0,0 +1,37 @@
+#ifndef GNGCONVERGE_H
+#define GNGCONVERGE_H
+
+#include <QObject>
+
+namespace GNG {
+  class GrowingNeuralGas;
+  class ConvergenceMonitor;
+}
+
+/**
+    Trains a GrowingNeuralGas for a number of steps and has a
+    ConvergenceMonitor measure it every time it emits updated(). The
+    time spent measuring is left out of the training time.
+*/
+class ConvergenceRun : public QObject {
+  Q_OBJECT
+  public:
+    ConvergenceRun(GNG::GrowingNeuralGas *gng, GNG::ConvergenceMonitor *monitor, int steps);
+
+    void start();
+
+  signals:
+    void finished();
+
+  private slots:
+    void measure();
+
+  private:
+    GNG::GrowingNeuralGas *m_gng;
+    GNG::ConvergenceMonitor *m_monitor;
+    int m_steps;
+    qint64 m_started;
+    qint64 m_measuring; // nanoseconds spent in measure()
+};
+
+#endif //GNGCONVERGE_H
@@ -0,0 +1,159 @@
+// Rebuilds the network recorded with --journal at any step:
+//
+//   ./gng-camera --journal session.gngj
+//   ./gng-replay --journal session.gngj --step 250000 --saveModel at250k.gngc
+//   ./gng-replay --journal session.gngj --show --stepsPerFrame 500
+
+#include "gngreplay.h"
+#include "gngviewer.h"
+
+#include <libgng/gng.h>
+#include <libgng/checkpoint.h>
+#include <libgng/clock.h>
+
+#include <QApplication>
+#include <QDebug>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <climits>
+
+namespace po=boost::program_options;
+using std::string;
+using namespace GNG;
+
+ReplayPlayer::ReplayPlayer(JournalReader* reader, GrowingNeuralGas* gng)
+  : m_reader(reader),
+    m_gng(gng),
+    m_stepsPerFrame(100),
+    m_lastStep(-1),
+    m_step(reader->step())
+{
+  connect(&m_timer, SIGNAL(timeout()), SLOT(nextFrame()));
+}
+
+void ReplayPlayer::setStepsPerFrame(int steps)
+{
+  m_stepsPerFrame = qMax(steps, 1);
+}
+
+void ReplayPlayer::setLastStep(int step)
+{
+  m_lastStep = step;
+}
+
+void ReplayPlayer::start(int fps)
+{
+  m_timer.start(1000 / qMax(fps, 1));
+}
+
+void ReplayPlayer::nextFrame()
+{
+  // Frames move on by the step, not by the reader, which stays put over
+  // stretches without records
+  m_step += m_stepsPerFrame;
+  if (m_lastStep >= 0) {
+    m_step = qMin(m_step, m_lastStep);
+  }
+  m_reader->advanceTo(m_step);
+  m_reader->toGng(m_gng);
+  if (m_reader->atEnd() || m_step == m_lastStep) {
+    m_timer.stop();
+    qDebug() << "Replay done at step" << m_reader->step();
+  }
+}
+
+typedef struct s_popts {
+  string journal;
+  int step;
+  string saveModel;
+  bool show;
+  int stepsPerFrame;
+  int fps;
+  int width;
+  int height;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+int main(int argc, char* argv[]) {
+  QApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  JournalReader reader;
+  if (!reader.open(QString::fromStdString(popts.journal))) {
+    exit(1);
+  }
+  GrowingNeuralGas gng(reader.dimension());
+
+  if (popts.show) {
+    GngViewer view;
+    view.setSize(popts.width, popts.height);
+    view.setGng(&gng);
+    view.show();
+
+    ReplayPlayer player(&reader, &gng);
+    player.setStepsPerFrame(popts.stepsPerFrame);
+    player.setLastStep(popts.step);
+    player.start(popts.fps);
+    return app.exec();
+  }
+
+  // Straight to the step, as fast as the journal can be read
+  qint64 started = monotonicTime();
+  reader.advanceTo(popts.step < 0 ? INT_MAX : popts.step);
+  qreal seconds = (monotonicTime() - started) / 1e9;
+
+  printf("Step %d: %d nodes, %d edges\n", reader.step(), reader.nodes().size(), reader.edges().size());
+  printf("Read %d records in %.3f s (%.0f steps/s)\n", reader.recordsRead(), seconds,
+         seconds > 0 ? reader.step() / seconds : 0.0);
+  if (reader.recordsLost() > 0) {
+    printf("The journal dropped %d records, the network is approximate\n", reader.recordsLost());
+  }
+
+  if (!popts.saveModel.empty()) {
+    reader.toGng(&gng);
+    if (!Checkpoint::save(gng, QString::fromStdString(popts.saveModel))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("journal,j", po::value<string>(&popts.journal), "Journal written with --journal")
+     ("step,s", po::value<int>(&popts.step)->default_value(-1), "Rebuild the network at this step, -1 for the end of the journal")
+     ("saveModel", po::value<string>(&popts.saveModel), "Save the rebuilt network to this checkpoint")
+     ("show", "Play the journal back in a window instead")
+     ("stepsPerFrame", po::value<int>(&popts.stepsPerFrame)->default_value(100), "Steps to advance per frame when playing back")
+     ("fps", po::value<int>(&popts.fps)->default_value(30), "Frames per second when playing back")
+     ("width", po::value<int>(&popts.width)->default_value(640), "Width of the playback window")
+     ("height", po::value<int>(&popts.height)->default_value(480), "Height of the playback window");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if (vm.count("help") || !vm.count("journal")){
+     std::cout << desc;
+     return false;
+   }
+   popts.show = vm.count("show");
+   return true;
+}
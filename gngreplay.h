@@ -0,0 +1,39 @@
+#ifndef GNGREPLAY_H
+#define GNGREPLAY_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <libgng/journalreader.h>
+
+namespace GNG {
+  class GrowingNeuralGas;
+}
+
+/**
+    Plays a journal back into a GrowingNeuralGas so a GngViewer can show
+    it, a fixed number of steps per frame.
+*/
+class ReplayPlayer : public QObject {
+  Q_OBJECT
+  public:
+    ReplayPlayer(GNG::JournalReader *reader, GNG::GrowingNeuralGas *gng);
+
+    void setStepsPerFrame(int steps);
+    /** Stop at this step, -1 plays to the end */
+    void setLastStep(int step);
+    void start(int fps);
+
+  private slots:
+    void nextFrame();
+
+  private:
+    GNG::JournalReader *m_reader;
+    GNG::GrowingNeuralGas *m_gng;
+    QTimer m_timer;
+    int m_stepsPerFrame;
+    int m_lastStep;
+    int m_step; // played up to, ahead of the reader when no record falls in a frame
+};
+
+#endif //GNGREPLAY_H
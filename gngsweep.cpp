@@ -0,0 +1,350 @@
+// Trains many GrowingNeuralGas configurations at once on one image, one
+// run per core, and writes a line of CSV per run: when it reached its
+// target error, and its node count and quantization error at the end.
+//
+//   ./gng-sweep -p ../images/rgb/rgb1.png -P winnerLearnRate=0.05,0.1,0.2 -P maxEdgeAge=25,50,100
+//   ./gng-sweep -p ../images/rgb/rgb1.png --random 64 -P winnerLearnRate=0.01:0.3 -P targetError=0.01:0.1
+//
+// A --param is a GrowingNeuralGas property and either a comma separated
+// list of values or, for --random searches, a min:max range. A grid runs
+// every combination of the lists, a random search draws --random
+// configurations. --base reads the starting values from a gng-image
+// config file.
+//
+// The image is converted once and shared by every run, and runs only
+// share read-only data, so the sweep scales with the cores.
+
+#include <libgng/gng.h>
+#include <libgng/hslimage.h>
+#include <libgng/sharedimagesource.h>
+#include <libgng/convergence.h>
+#include <libgng/clock.h>
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QVariant>
+#include <QMetaProperty>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QtConcurrentMap>
+
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace po=boost::program_options;
+using std::string;
+using std::vector;
+using namespace GNG;
+
+/** A swept property: values for a grid, or a range for random draws */
+struct Parameter {
+  QByteArray name;
+  bool integer;
+  QList<QVariant> values;
+  qreal minimum;
+  qreal maximum;
+};
+
+typedef QList<QPair<QByteArray, QVariant> > Settings;
+
+/** One configuration and seed, and what training it gave */
+struct SweepRun {
+  int index;
+  Settings settings;
+  quint32 seed;
+  int steps;
+  const HslImage *frame;
+  const ConvergenceMonitor *monitor;
+
+  int targetStep; /**< -1 if the target error wasn't reached */
+  qreal targetSeconds;
+  int stepsRun; /**< Fewer than steps if the source ran out */
+  qreal seconds;
+  int nodes;
+  qreal averageError;
+  qreal quantizationError;
+};
+
+static QAtomicInt finishedRuns;
+static int totalRuns;
+
+static void train(SweepRun &run)
+{
+  // The GNG places its first nodes with qrand(), which is per thread
+  qsrand(run.seed);
+  SharedImageSource source(*run.frame, run.seed);
+  GrowingNeuralGas gng(source.dimension());
+  gng.setPointGenerator(&source);
+  gng.setUpdateInterval(0);
+  for (int i=0; i<run.settings.size(); i++) {
+    gng.setProperty(run.settings[i].first.constData(), run.settings[i].second);
+  }
+  gng.stopAt(run.steps);
+
+  // A step at a time until the target error, to time reaching it exactly
+  qint64 started = monotonicTime();
+  while (gng.targetErrorStep() < 0 && gng.runSynchronous(1) == 1) {
+  }
+  run.targetStep = gng.targetErrorStep();
+  run.targetSeconds = run.targetStep < 0 ? -1 : (monotonicTime() - started) / 1e9;
+  gng.runSynchronous(run.steps);
+  run.seconds = (monotonicTime() - started) / 1e9;
+  run.stepsRun = gng.currentStep();
+
+  run.nodes = gng.nodes().size();
+  run.averageError = gng.lastAverageError();
+  // Every core is busy with runs already
+  run.quantizationError = run.monitor->quantizationError(gng, false);
+
+  fprintf(stderr, "run %d of %d done\n", int(finishedRuns.fetchAndAddOrdered(1)) + 1, totalRuns);
+}
+
+// "name=value,value,..." or "name=min:max"
+static bool parseParameter(const QString &spec, const QMetaObject *meta, Parameter *parameter)
+{
+  QString name = spec.section('=', 0, 0).trimmed();
+  QString values = spec.section('=', 1).trimmed();
+  int index = meta->indexOfProperty(name.toLatin1().constData());
+  if (index < 0 || values.isEmpty()) {
+    std::cerr << "Can't sweep " << spec.toStdString() << ": not a GrowingNeuralGas property and values" << std::endl;
+    return false;
+  }
+  parameter->name = name.toLatin1();
+  parameter->integer = meta->property(index).type() == QVariant::Int;
+  parameter->minimum = parameter->maximum = 0;
+
+  bool ok = true;
+  if (values.contains(':')) {
+    parameter->minimum = values.section(':', 0, 0).toDouble(&ok);
+    parameter->maximum = ok ? values.section(':', 1).toDouble(&ok) : 0;
+  } else {
+    foreach (QString value, values.split(',', QString::SkipEmptyParts)) {
+      qreal number = value.toDouble(&ok);
+      if (!ok) {
+        break;
+      }
+      parameter->values.append(parameter->integer ? QVariant(qRound(number)) : QVariant(number));
+    }
+  }
+  if (!ok) {
+    std::cerr << "Can't read the values in " << spec.toStdString() << std::endl;
+  }
+  return ok;
+}
+
+// The GNG properties in a gng-image config file, anything else is skipped
+static bool readBase(const string &fileName, const QMetaObject *meta, Settings *base)
+{
+  QFile file(QString::fromStdString(fileName));
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    std::cerr << "Could not read " << fileName << std::endl;
+    return false;
+  }
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QString line = in.readLine().section('#', 0, 0);
+    QByteArray name = line.section('=', 0, 0).trimmed().toLatin1();
+    int index = meta->indexOfProperty(name.constData());
+    if (!line.contains('=') || index < 0) {
+      continue;
+    }
+    qreal value = line.section('=', 1).trimmed().toDouble();
+    bool integer = meta->property(index).type() == QVariant::Int;
+    base->append(qMakePair(name, integer ? QVariant(qRound(value)) : QVariant(value)));
+  }
+  return true;
+}
+
+static qreal randomUniform()
+{
+  return qrand() / (RAND_MAX + 1.0);
+}
+
+
+typedef struct s_popts {
+  string imagePath;
+  string base;
+  vector<string> params;
+  int random;
+  int repeats;
+  int steps;
+  int heldOut;
+  int threads;
+  int seed;
+  string csv;
+} ProgOpts;
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts);
+
+int main(int argc, char* argv[]) {
+  QCoreApplication app(argc, argv);
+
+  // get command-line arguments
+  ProgOpts popts;
+  if(!parse_args(argc, argv, popts))
+    exit(1);
+
+  QImage image(QString::fromStdString(popts.imagePath));
+  if (image.isNull()) {
+    std::cerr << "Could not read " << popts.imagePath << std::endl;
+    exit(1);
+  }
+  HslImage frame;
+  frame.convert(image);
+
+  const QMetaObject *meta = &GrowingNeuralGas::staticMetaObject;
+  Settings base;
+  if (!popts.base.empty() && !readBase(popts.base, meta, &base)) {
+    exit(1);
+  }
+  QList<Parameter> parameters;
+  foreach (string spec, popts.params) {
+    Parameter parameter;
+    if (!parseParameter(QString::fromStdString(spec), meta, &parameter)) {
+      exit(1);
+    }
+    if (popts.random <= 0 && parameter.values.isEmpty()) {
+      std::cerr << "Ranges need --random, give a list of values for a grid: " << spec << std::endl;
+      exit(1);
+    }
+    parameters.append(parameter);
+  }
+
+  // Every combination of the lists, or random draws
+  QList<Settings> configurations;
+  if (popts.random > 0) {
+    qsrand(popts.seed);
+    for (int i=0; i<popts.random; i++) {
+      Settings settings = base;
+      foreach (const Parameter &parameter, parameters) {
+        QVariant value;
+        if (!parameter.values.isEmpty()) {
+          value = parameter.values[qrand() % parameter.values.size()];
+        } else {
+          qreal number = parameter.minimum + randomUniform()*(parameter.maximum - parameter.minimum);
+          value = parameter.integer ? QVariant(qRound(number)) : QVariant(number);
+        }
+        settings.append(qMakePair(parameter.name, value));
+      }
+      configurations.append(settings);
+    }
+  } else {
+    configurations.append(base);
+    foreach (const Parameter &parameter, parameters) {
+      QList<Settings> combined;
+      foreach (const Settings &settings, configurations) {
+        foreach (const QVariant &value, parameter.values) {
+          combined.append(settings);
+          combined.last().append(qMakePair(parameter.name, value));
+        }
+      }
+      configurations = combined;
+    }
+  }
+
+  // The held-out points come from a seed no run trains with
+  SharedImageSource heldOutSource(frame, ~quint32(popts.seed));
+  ConvergenceMonitor monitor(&heldOutSource, popts.heldOut);
+
+  QList<SweepRun> runs;
+  for (int i=0; i<configurations.size(); i++) {
+    for (int repeat=0; repeat<popts.repeats; repeat++) {
+      SweepRun run;
+      run.index = i;
+      run.settings = configurations[i];
+      run.seed = popts.seed + repeat;
+      run.steps = popts.steps;
+      run.frame = &frame;
+      run.monitor = &monitor;
+      runs.append(run);
+    }
+  }
+  totalRuns = runs.size();
+
+  // Free threads take the next run, so short runs don't wait on long ones
+  if (popts.threads > 0) {
+    QThreadPool::globalInstance()->setMaxThreadCount(popts.threads);
+  }
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  fprintf(stderr, "%d runs of %d steps on %d threads\n", totalRuns, popts.steps, threads);
+  qint64 started = monotonicTime();
+  QtConcurrent::blockingMap(runs, train);
+  qreal wallSeconds = (monotonicTime() - started) / 1e9;
+
+  QFile csvFile;
+  if (popts.csv.empty()) {
+    csvFile.open(stdout, QIODevice::WriteOnly);
+  } else {
+    csvFile.setFileName(QString::fromStdString(popts.csv));
+    if (!csvFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      std::cerr << "Could not write " << popts.csv << std::endl;
+      exit(1);
+    }
+  }
+  QTextStream csv(&csvFile);
+  csv << "configuration,seed";
+  foreach (const Parameter &parameter, parameters) {
+    csv << "," << parameter.name;
+  }
+  csv << ",targetStep,targetSeconds,steps,seconds,nodes,averageError,quantizationError\n";
+  qreal runSeconds = 0;
+  foreach (const SweepRun &run, runs) {
+    csv << run.index << "," << run.seed;
+    // The swept values come after the base ones
+    for (int i=base.size(); i<run.settings.size(); i++) {
+      csv << "," << run.settings[i].second.toString();
+    }
+    csv << "," << run.targetStep << "," << run.targetSeconds << "," << run.stepsRun << "," << run.seconds
+        << "," << run.nodes << "," << run.averageError << "," << run.quantizationError << "\n";
+    runSeconds += run.seconds;
+  }
+  csv.flush();
+
+  // Close to the thread count when the sweep scales
+  fprintf(stderr, "%.2f s of training in %.2f s, %.2f runs at a time on %d threads\n",
+          runSeconds, wallSeconds, runSeconds / qMax(wallSeconds, qreal(1e-9)), threads);
+  return 0;
+};
+
+bool parse_args(int argc, char* argv[], ProgOpts& popts){
+   string configFile;
+   po::options_description desc("Allowed options");
+   desc.add_options()
+     ("help,h", "Show this message")
+     ("config,c", po::value<string>(&configFile), "Config file to read options from")
+     ("imagePath,p", po::value<string>(&popts.imagePath), "Image every run trains on")
+     ("base,b", po::value<string>(&popts.base), "gng-image config file with the values of the properties not swept")
+     ("param,P", po::value<vector<string> >(&popts.params), "A property to sweep, \"name=value,value,...\" or \"name=min:max\" with --random. Repeat for several")
+     ("random", po::value<int>(&popts.random)->default_value(0), "Draw this many random configurations instead of running the whole grid")
+     ("repeats", po::value<int>(&popts.repeats)->default_value(1), "Runs of every configuration, each with the next seed")
+     ("steps,s", po::value<int>(&popts.steps)->default_value(100000), "Steps to train every run for")
+     ("heldOut", po::value<int>(&popts.heldOut)->default_value(2000), "Held-out points the quantization error is measured on")
+     ("threads,j", po::value<int>(&popts.threads)->default_value(0), "Runs at a time, 0 for one per core")
+     ("seed", po::value<int>(&popts.seed)->default_value(1), "Seed of the first repeat and of the random search")
+     ("csv", po::value<string>(&popts.csv), "Write the results to this file instead of stdout");
+   po::variables_map vm;
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if(vm.count("config")){
+     std::ifstream ifs(vm["config"].as<string>().c_str());
+     store(parse_config_file(ifs, desc), vm);
+     notify(vm);
+   }
+   po::store(po::parse_command_line(argc, argv, desc), vm);
+   po::notify(vm);
+   if (vm.count("help") || !vm.count("imagePath")){
+     std::cout << desc;
+           return false;
+   }
+   popts.repeats = qMax(popts.repeats, 1);
+   popts.steps = qMax(popts.steps, 1);
+   popts.heldOut = qMax(popts.heldOut, 1);
+   return true;
+}
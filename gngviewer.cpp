@@ -5,6 +5,8 @@
 #include <libgng/node.h>
 #include <libgng/edge.h>
 #include <libgng/camerasource.h>
+#include <libgng/labelmap.h>
+#include <libaibo/trace.h>
 
 #include <QPainter>
 #include <QDebug>
@@ -13,6 +15,10 @@
 
 using namespace GNG;
 
+// Labeling a frame takes long on the GUI thread, so a new frame or
+// network is labeled at most this often (ms)
+static const int LabelInterval = 1000;
+
 GngViewer::GngViewer(QWidget* parent)
   : QWidget(parent)
 {
@@ -20,15 +26,19 @@ GngViewer::GngViewer(QWidget* parent)
   m_gng = 0;
   m_cameraSource = 0;
   m_paintBackground = false;
+  m_showLabels = false;
+  m_labelMap = new LabelMap;
+  m_labeledFrame = 0;
+  m_labelsStale = true;
   
   // Set widget to repaint 25 times per second
   m_repaintTimer.setInterval(40);
-  connect(&m_repaintTimer, SIGNAL(timeout()), SLOT(update()));
+  connect(&m_repaintTimer, SIGNAL(timeout()), SLOT(refresh()));
 }
 
 GngViewer::~GngViewer()
 {
-
+  delete m_labelMap;
 }
 
 void GngViewer::setSize(int width, int height)
@@ -44,6 +54,7 @@ void GngViewer::setSize(int width, int height)
 void GngViewer::setGng(GrowingNeuralGas* gng)
 {
   m_gng = gng;
+  connect(m_gng, SIGNAL(updated()), SLOT(gngUpdated()));
   update();
   m_repaintTimer.start();
 }
@@ -72,6 +83,39 @@ void GngViewer::setImage(QImage image)
   setSource(QPixmap::fromImage(image));
 }
 
+void GngViewer::refresh()
+{
+  updateLabels();
+  update();
+}
+
+void GngViewer::gngUpdated()
+{
+  m_labelsStale = true;
+}
+
+// Labels the frame again if it or the network changed, but not more
+// often than LabelInterval
+void GngViewer::updateLabels()
+{
+  if (!m_showLabels || !m_gng || !m_paintBackground) {
+    return;
+  }
+  QImage frame = m_cameraSource ? m_cameraSource->image() : m_background.toImage();
+  qint64 key = m_cameraSource ? frame.cacheKey() : m_background.cacheKey();
+  if (key == m_labeledFrame && !m_labelsStale) {
+    return;
+  }
+  if (!m_labelImage.isNull() && m_labelTime.elapsed() < LabelInterval) {
+    return;
+  }
+  m_gng->generateSubgraphs();
+  m_labelImage = m_labelMap->label(frame, *m_gng) ? m_labelMap->toImage() : QImage();
+  m_labeledFrame = key;
+  m_labelsStale = false;
+  m_labelTime.start();
+}
+
 qreal GngViewer::unNormalize(qreal value, qreal maxValue)
 {
   return maxValue*value;
@@ -91,6 +135,7 @@ void GngViewer::drawTextInFrame(QPainter *painter, const QPoint& topLeft, const
 
 void GngViewer::paintEvent(QPaintEvent* e)
 { 
+  TRACE_SCOPE("GngViewer::paintEvent");
   //QWidget::paintEvent(e);
   QPainter painter(this);
   painter.setRenderHint(QPainter::Antialiasing);
@@ -99,7 +144,11 @@ void GngViewer::paintEvent(QPaintEvent* e)
     if (m_cameraSource) {
       m_background = QPixmap::fromImage(m_cameraSource->image());
     }
-    painter.drawPixmap(rect(), m_background);
+    if (m_showLabels && !m_labelImage.isNull()) {
+      painter.drawImage(rect(), m_labelImage);
+    } else {
+      painter.drawPixmap(rect(), m_background);
+    }
   }
   
   if (!m_gng) {
@@ -204,7 +253,7 @@ void GngViewer::paintEvent(QPaintEvent* e)
 
 void GngViewer::keyPressEvent(QKeyEvent* e)
 {
-  if (e->key() == Qt::Key_Space) {
+  if (e->key() == Qt::Key_Space || e->key() == Qt::Key_L) {
     e->accept();
   }
 }
@@ -215,6 +264,11 @@ void GngViewer::keyReleaseEvent(QKeyEvent* e)
       qDebug() << "toggle playpause";
       m_gng->togglePause();
     }
+  } else if (e->key() == Qt::Key_L) {
+    m_showLabels = !m_showLabels;
+    // Labels right away rather than waiting out LabelInterval
+    m_labelImage = QImage();
+    updateLabels();
   }
 }
 
@@ -4,10 +4,13 @@
 
 #include <QWidget>
 #include <QTimer>
+#include <QTime>
+#include <QImage>
 
 namespace GNG {
   class CameraSource;
   class GrowingNeuralGas;
+  class LabelMap;
 }
   
 class GngViewer : public QWidget {
@@ -23,6 +26,10 @@ class GngViewer : public QWidget {
     
   public slots:
     void setImage(QImage image);
+
+  private slots:
+    void refresh();
+    void gngUpdated();
     
   protected:
     virtual void paintEvent(QPaintEvent* e);
@@ -32,6 +39,7 @@ class GngViewer : public QWidget {
   private:
     qreal unNormalize(qreal value, qreal maxValue);
     void drawTextInFrame(QPainter *painter, const QPoint &topLeft, const QString &text);
+    void updateLabels();
     QTimer m_repaintTimer;
     int m_width;
     int m_height;
@@ -40,6 +48,12 @@ class GngViewer : public QWidget {
     GNG::CameraSource *m_cameraSource;
     QPixmap m_background;
     bool m_paintBackground;
+    bool m_showLabels; // segmentation instead of the frame, toggled with L
+    GNG::LabelMap *m_labelMap;
+    QImage m_labelImage; // drawn by paintEvent(), made by updateLabels()
+    qint64 m_labeledFrame; // cacheKey() of the frame in m_labelImage
+    bool m_labelsStale; // the GNG changed since
+    QTime m_labelTime;
 };
 
 
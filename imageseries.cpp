@@ -2,8 +2,15 @@
 #include "gngviewer.h"
 #include "gngapp.h"
 #include "libgng/gng.h"
+#include "libgng/checkpoint.h"
+#include "libgng/journal.h"
+#include "libgng/stepprofile.h"
+#include "libgng/metricsserver.h"
+#include "libaibo/trace.h"
 #include "libgng/imagesource.h"
 #include "libgng/node.h"
+#include "libgng/backgroundmodel.h"
+#include "libgng/motionmap.h"
 
 #include <boost/program_options.hpp>
 #include <string>
@@ -31,6 +38,21 @@ typedef struct s_popts {
   float errorReduction;
   float insertErrorReduction;
   int totalIterations;
+  string loadModel;
+  string saveModel;
+  string journal;
+  bool profile;
+  bool greedySearch;
+  int metricsPort;
+  string trace;
+  string initModel;
+  int initEdgeAge;
+  string background;
+  string backgroundColor;
+  int backgroundTolerance;
+  float motionFraction;
+  float motionThreshold;
+  int staticStepLimit;
 } ProgOpts;
 
 bool parse_args(int argc, char* argv[], ProgOpts& popts);
@@ -44,6 +66,11 @@ int main(int argc, char* argv[]) {
   if(!parse_args(argc, argv, popts))
     exit(1);
 
+  // Before any thread to trace is started
+  if (!popts.trace.empty()) {
+    Trace::start();
+  }
+
   // Create the GNG object with bounds of 0 and 1.
   GrowingNeuralGas gng(5);
 
@@ -58,6 +85,7 @@ int main(int argc, char* argv[]) {
   gng.setErrorReduction(popts.errorReduction);
   gng.setInsertErrorReduction(popts.insertErrorReduction);
   gng.setUpdateInterval(popts.updateInterval);
+  gng.setStaticStepLimit(popts.staticStepLimit);
 
  
   QDir imagesDir(QString::fromStdString(popts.imagesDir));
@@ -73,6 +101,28 @@ int main(int argc, char* argv[]) {
   // The ImageGenerator provides the source points for the gng (similar to the distribution)
   QImage firstImg(imagesDir.absoluteFilePath(imagesDir.entryList(QDir::Files).first()));
   ImageSource generator(firstImg);
+  // Keep the GNG's nodes off the background by only sampling foreground pixels
+  bool validBackground;
+  BackgroundModel background(BackgroundModel::modeFromName(QString::fromStdString(popts.background), &validBackground));
+  if (!validBackground) {
+    qDebug() << "Unknown background model" << QString::fromStdString(popts.background);
+    exit(1);
+  }
+  QColor backgroundColor(QString::fromStdString(popts.backgroundColor));
+  if (!backgroundColor.isValid()) {
+    qDebug() << "Invalid background color" << QString::fromStdString(popts.backgroundColor);
+    exit(1);
+  }
+  background.setColor(backgroundColor);
+  background.setTolerance(popts.backgroundTolerance);
+  generator.setBackgroundModel(&background);
+  // Draw part of the samples from whatever moved since the last frame
+  MotionMap motion;
+  motion.setSampleFraction(popts.motionFraction);
+  motion.setThreshold(popts.motionThreshold);
+  if (popts.motionFraction > 0 || popts.staticStepLimit > 0) {
+    generator.setMotionMap(&motion);
+  }
   QPixmap firstImgPixmap = QPixmap::fromImage(firstImg);
   view.setSource(firstImgPixmap);
   
@@ -89,13 +139,57 @@ int main(int argc, char* argv[]) {
   // Give the GNG its way of generating points
   gng.setPointGenerator(&generator);
 
+  // Pick up a saved network. The parameters come from the command line,
+  // so only the network is restored
+  if (!popts.loadModel.empty()
+      && !Checkpoint::load(&gng, QString::fromStdString(popts.loadModel), Checkpoint::Network)) {
+    exit(1);
+  }
+  // Or start over from a network trained on a similar scene
+  if (!popts.initModel.empty()
+      && !gng.loadInitialNetwork(QString::fromStdString(popts.initModel), popts.initEdgeAge)) {
+    exit(1);
+  }
+
+  // Attached after loading, so the journal starts from the loaded network
+  Journal journal(QString::fromStdString(popts.journal), 5);
+  if (!popts.journal.empty()) {
+    if (!journal.open()) {
+      exit(1);
+    }
+    gng.setJournal(&journal);
+  }
+  gng.setProfiling(popts.profile);
+  gng.setGreedySearch(popts.greedySearch);
+
+  MetricsServer metrics;
+  metrics.setGng(&gng);
+  if (popts.metricsPort > 0 && !metrics.listen(popts.metricsPort)) {
+    exit(1);
+  }
+
   // Run the GNG during idle processing for 10,000 cycles
-  gng.stopAt(popts.totalIterations);
+  gng.stopAt(gng.currentStep() + popts.totalIterations);
   gng.start();
 
   // Execute the Qt mainloop. Needed for widgets to update themselves/for events to happen
   app.runMovie();
-  // This area is never reached by the program
+
+  if (gng.profile()) {
+    std::cout << gng.profile()->report().toStdString();
+  }
+  if (gng.greedySearch()) {
+    std::cout << gng.greedyFallbacks() << " of " << gng.greedySearches() << " greedy winner searches fell back to the exact search, "
+              << gng.greedyAgreements() << " of " << gng.greedyAudits() << " checked found the exact winner and "
+              << gng.greedySecondAgreements() << " the exact second winner" << std::endl;
+  }
+  if (!popts.trace.empty()) {
+    Trace::save(QString::fromStdString(popts.trace));
+  }
+
+  if (!popts.saveModel.empty()) {
+    Checkpoint::save(gng, QString::fromStdString(popts.saveModel));
+  }
 }
 
 bool parse_args(int argc, char* argv[], ProgOpts& popts){
@@ -115,7 +209,22 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
      ("targetError,e", po::value<float>(&popts.targetError)->default_value(0.001), "Continue inserting nodes until the average error has reached this threshold")
      ("errorReduction,r", po::value<float>(&popts.errorReduction)->default_value(0.1), "All errors are reduced by this amount each GNG step")
      ("insertErrorReduction,s", po::value<float>(&popts.insertErrorReduction)->default_value(0.5), "Reduce new unit's error by this much")
-     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total");
+     ("totalIterations,t", po::value<int>(&popts.totalIterations)->default_value(100000), "Run this many iterations in total")
+     ("loadModel", po::value<string>(&popts.loadModel), "Continue training the network saved in this checkpoint")
+     ("saveModel", po::value<string>(&popts.saveModel), "Save the network to this checkpoint on exit")
+     ("journal", po::value<string>(&popts.journal), "Record every change to the network to this file, for gng-replay")
+     ("profile", "Time every phase of the GNG step and print a report on exit. Needs a GNG_PROFILING build")
+     ("greedySearch", "Find the winners by walking the edges from the last winner instead of measuring every node")
+     ("metricsPort", po::value<int>(&popts.metricsPort)->default_value(0), "Serve live metrics for Prometheus on this localhost port, 0 for none")
+     ("trace", po::value<string>(&popts.trace), "Record a timeline of every thread to this file, in Chrome trace_event JSON for chrome://tracing or Perfetto. Keeps the last 262144 events of each thread")
+     ("initModel", po::value<string>(&popts.initModel), "Start from the network saved in this checkpoint instead of two random nodes")
+     ("initEdgeAge", po::value<int>(&popts.initEdgeAge)->default_value(-1), "Age given to every edge of the initial network, -1 keeps the saved ages. Near maxEdgeAge, edges the scene no longer has are pruned quickly")
+     ("background,b", po::value<string>(&popts.background)->default_value("none"), "Background model: none, color or learned. Background pixels are never sampled")
+     ("backgroundColor", po::value<string>(&popts.backgroundColor)->default_value("#ffffff"), "Background color used by the color model")
+     ("backgroundTolerance", po::value<int>(&popts.backgroundTolerance)->default_value(50), "Max per channel difference (0-255) from the background that is still background")
+     ("motionFraction", po::value<float>(&popts.motionFraction)->default_value(0), "Fraction of samples drawn from the regions that changed since the last frame")
+     ("motionThreshold", po::value<float>(&popts.motionThreshold)->default_value(0.03), "Mean lightness difference (0-1) above which a region counts as changed")
+     ("staticStepLimit", po::value<int>(&popts.staticStepLimit)->default_value(0), "Pause the GNG after this many steps without a change in the scene. 0 never pauses");
    po::variables_map vm;
    po::store(po::parse_command_line(argc, argv, desc), vm);
    po::notify(vm);
@@ -130,5 +239,7 @@ bool parse_args(int argc, char* argv[], ProgOpts& popts){
      std::cout << desc;
 	   return false;
    }
+   popts.profile = vm.count("profile");
+   popts.greedySearch = vm.count("greedySearch");
    return true;
 }
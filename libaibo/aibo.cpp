@@ -1,4 +1,7 @@
 #include "aibo.h"
+#include "cameradecoder.h"
+#include "controlscheduler.h"
+#include "trace.h"
 
 #include <QtNetwork/QTcpSocket>
 #include <QImage>
@@ -7,16 +10,6 @@
 #include <QTimer>
 #include <QMutex>
 
-// Convert from little endian to big endian?
-long convert(char *buff) {
-  long retval = 0;
-  retval += (buff[0] & 0xFF) <<  0;
-  retval += (buff[1] & 0xFF) <<  8;
-  retval += (buff[2] & 0xFF) << 16;
-  retval += (buff[3] & 0xFF) << 24;
-  return retval;
-}
-
 Aibo::Aibo(const QString& hostname, QObject* parent)
   : QObject(parent)
 {
@@ -37,11 +30,13 @@ Aibo::Aibo(const QString& hostname, QObject* parent)
   // Initialize camera
   m_cameraRunning = false;
   m_dataAccess->lock();
-  m_currentFrame = QImage(416, 320, QImage::Format_RGB32);
-  m_currentFrame.fill(0); // fill with black
+  m_currentYCbCr = YCbCrImage(416, 320); // black
+  m_currentFrame = m_currentYCbCr.toImage();
+  m_currentFrameKey = m_currentYCbCr.cacheKey();
   m_dataAccess->unlock();
-  m_cameraHeaderStage = true;
-  m_cameraFrameSize = 0;
+  m_cameraFramesReceived = 0;
+  m_cameraDecoder = new CameraDecoder(this);
+  connect(m_cameraDecoder, SIGNAL(frameDecoded(YCbCrImage)), SLOT(cameraFrameDecoded(YCbCrImage)));
   connect(m_cameraSocket, SIGNAL(readyRead()), SLOT(cameraSocketReadyRead()));
   connect(m_cameraSocket, SIGNAL(error(QAbstractSocket::SocketError)),
           SLOT(cameraSocketError(QAbstractSocket::SocketError)));
@@ -55,6 +50,15 @@ Aibo::Aibo(const QString& hostname, QObject* parent)
   m_walkControlRunning = false;
   connect(m_walkSocket, SIGNAL(error(QAbstractSocket::SocketError)),
           SLOT(walkSocketError(QAbstractSocket::SocketError)));
+  
+  // Control characters as understood by Tekkotsu's remote controls
+  m_controls = new ControlScheduler(this);
+  m_controls->addChannel(HeadTilt, m_headSocket, 't');
+  m_controls->addChannel(HeadPan, m_headSocket, 'p');
+  m_controls->addChannel(HeadRoll, m_headSocket, 'r');
+  m_controls->addChannel(BodyTranslate, m_walkSocket, 'f');
+  m_controls->addChannel(BodyRotate, m_walkSocket, 'r');
+  m_controls->addChannel(BodyStrafe, m_walkSocket, 's');
 
   connect(m_estopSocket, SIGNAL(error(QAbstractSocket::SocketError)),
           SLOT(estopSocketError(QAbstractSocket::SocketError)));
@@ -66,6 +70,7 @@ Aibo::Aibo(const QString& hostname, QObject* parent)
 
 Aibo::~Aibo()
 {
+  m_cameraDecoder->stop();
   delete m_dataAccess;
 }
 
@@ -88,7 +93,7 @@ void Aibo::startCamera(Aibo::Resolution resolution)
   };
   
   set("vision.rawcam_encoding", "color");
-  set("vision.rawcam_interval", "50"); // Set ms delay to 25. (40fps) //TODO
+  set("vision.rawcam_interval", "25"); // 40fps, the camera's full rate
   set("vision.rawcam_compress_quality", "85");
   set("vision.rawcam_transport", "tcp");
   set("vision.rawcam_compression", "jpeg");
@@ -96,6 +101,8 @@ void Aibo::startCamera(Aibo::Resolution resolution)
   // Turn camera on
   sendCommand("!select \"Raw Cam Server\"");
   m_cameraRunning = true;
+  m_cameraStream.clear();
+  m_cameraDecoder->start();
 
   // Wait a second so that the camera server can start up
   QTimer::singleShot(1000, this, SLOT(cameraConnect()));
@@ -109,6 +116,7 @@ void Aibo::stopCamera()
   m_cameraSocket->disconnectFromHost();
   sendCommand("!select \"#Raw Cam Server\"");
   m_cameraRunning = false;
+  m_cameraDecoder->stop();
 }
 bool Aibo::isCameraRunning() const
 {
@@ -116,8 +124,53 @@ bool Aibo::isCameraRunning() const
 }
 QImage Aibo::cameraImage() const
 {
+  if (m_currentFrameKey != m_currentYCbCr.cacheKey()) {
+    m_currentFrame = m_currentYCbCr.toImage();
+    m_currentFrameKey = m_currentYCbCr.cacheKey();
+  }
   return m_currentFrame;
 }
+YCbCrImage Aibo::cameraYCbCr() const
+{
+  return m_currentYCbCr;
+}
+void Aibo::setCameraDecodeScale(int scale)
+{
+  m_cameraDecoder->setScale(scale);
+}
+int Aibo::cameraDecodeScale() const
+{
+  return m_cameraDecoder->scale();
+}
+int Aibo::cameraFramesReceived() const
+{
+  return m_cameraFramesReceived;
+}
+int Aibo::cameraFramesDropped() const
+{
+  return m_cameraDecoder->droppedFrames();
+}
+qreal Aibo::cameraDecodeLatency() const
+{
+  return m_cameraDecoder->decodeLatency();
+}
+
+void Aibo::setControlRate(int rate)
+{
+  m_controls->setRate(rate);
+}
+int Aibo::controlRate() const
+{
+  return m_controls->rate();
+}
+int Aibo::controlPacketsSent() const
+{
+  return m_controls->packetsSent();
+}
+qreal Aibo::controlLatency() const
+{
+  return m_controls->averageLatency();
+}
 
 // Head Control Meta Functions
 void Aibo::startHeadControl()
@@ -179,67 +232,31 @@ void Aibo::mainSocketReadyRead()
 {
 
 }
+// Parsing is incremental and cheap, so it stays on this thread. Complete
+// images go to the decoder thread, which hands back the decoded frame
+// through cameraFrameDecoded().
 void Aibo::cameraSocketReadyRead()
-{ 
-  if (m_cameraHeaderStage) {
-    if (m_cameraSocket->bytesAvailable() < 1000) {
-      return;
-    }
-    
-    // Types taken from aibolib.cpp
-    char *header, *type, *creator, *fmt;
-    long format, compression, timeStamp, frameNum, unknown1;
-    long chanWidth, chanHeight, layer, chanID, unknown2;
-    
-    header = m_cameraSocket->read(4).data();  // \r\0\0\0
-    type = readUntil(m_cameraSocket, (char)0); // "TekkotsuImage"
-    format = convert(m_cameraSocket->read(4).data());
-    compression = convert(m_cameraSocket->read(4).data());
-    m_newWidth = convert(m_cameraSocket->read(4).data());
-    m_newHeight = convert(m_cameraSocket->read(4).data());
-    timeStamp = convert(m_cameraSocket->read(4).data());
-    frameNum = convert(m_cameraSocket->read(4).data());
-    unknown1 = convert(m_cameraSocket->read(4).data());
-    //printf("unknown1: %ld\n", unknown1);
-    //// Got creator=FbkImage
-    //// Got chanwidth=104
-    //// Got chanheight=80
-    //// Got layer=3
-    //// Got chan_id=0
-    //// Got fmt=JPEGColor
-    //// read JPEG: len=2547
-    creator = readUntil(m_cameraSocket, (char)0); // creator
-    chanWidth = convert(m_cameraSocket->read(4).data());
-    chanHeight = convert(m_cameraSocket->read(4).data());
-    layer = convert(m_cameraSocket->read(4).data());
-    chanID = convert(m_cameraSocket->read(4).data());
-    unknown2 = convert(m_cameraSocket->read(4).data());
-    fmt = readUntil(m_cameraSocket, (char)0); // fmt
-    m_cameraFrameSize = convert(m_cameraSocket->read(4).data());
-    m_cameraHeaderStage = false;
-
-  } else if (m_cameraSocket->bytesAvailable() < m_cameraFrameSize + 100) { // This is just me being paranoid, 100 isn't needed 
-    return;
-  } else {
-    //qDebug() << "Image of size" << m_newWidth << m_newHeight << "with data size" << m_cameraFrameSize;
-    //   qDebug() << type << creator << fmt;
-    //   qDebug() << "frame" << frameNum << "chan w/h" << chanWidth << chanHeight <<chanID;
-    int bytesAvailable = m_cameraSocket->bytesAvailable();
-    char *image_buffer = m_cameraSocket->read(m_cameraFrameSize).data();
-    bool success = true;
-    m_dataAccess->lock();
-    m_currentFrame = QImage(m_newWidth, m_newHeight, QImage::Format_RGB32);
-    if (!m_currentFrame.loadFromData((uchar*)image_buffer, m_cameraFrameSize, "JPG")) {
-      qDebug() << "Failed loading data. Size:" << m_cameraFrameSize << "and bytesAvailable" << bytesAvailable;
-      success = false;
-    }
-    m_dataAccess->unlock();
-    
-    m_cameraHeaderStage = true;
-    
-    if (success) {
-      emit cameraFrame(m_currentFrame);
-    }
+{
+  TRACE_SCOPE("Aibo::cameraSocketReadyRead");
+  m_cameraStream.readFrom(m_cameraSocket);
+  
+  CameraPacket packet;
+  while (m_cameraStream.next(&packet)) {
+    m_cameraFramesReceived++;
+    m_cameraDecoder->decode(packet);
+  }
+}
+void Aibo::cameraFrameDecoded(YCbCrImage frame)
+{
+  // Queued from the decoder thread, the lock only guards readers on other threads
+  m_dataAccess->lock();
+  m_currentYCbCr = frame;
+  m_dataAccess->unlock();
+  emit cameraFrameReady();
+  
+  // Only pay for the RGB conversion if someone displays the frames
+  if (receivers(SIGNAL(cameraFrame(QImage))) > 0) {
+    emit cameraFrame(cameraImage());
   }
 }
 
@@ -343,24 +360,6 @@ void Aibo::setJoint(Aibo::Joint joint, qreal x, qreal y, qreal z)
 
 
 // Utilities
-char* Aibo::readUntil(QTcpSocket *socket, char stop)
-{
-  // Fuck. C programming at its finest (worst)
-  static char retval[100]; // max buffer? 50?
-  int numbytes = 0;
-  char character[5];
-  int pos = 0;
-  numbytes = socket->read((char*)&character, 1);
-  
-  while (character[0] != stop && numbytes == 1 && pos < 50) { // no text is > 50
-    retval[pos++] = character[0];
-    numbytes = socket->read((char*)&character, 1);
-  }
-  retval[pos] = 0; // end of string
-  //printf("readUntil: read %d chars\n", pos);
-  return retval;
-}
-
 void Aibo::sendCommand(const QString& command, QTcpSocket *socket)
 {
   if (socket == 0) {
@@ -370,47 +369,7 @@ void Aibo::sendCommand(const QString& command, QTcpSocket *socket)
 }
 void Aibo::sendControl(Control control, float amount)
 {
-  QTcpSocket *socket;
-  QChar controlChar;
-  switch (control) {
-    case HeadTilt:
-      controlChar = 't';
-      socket = m_headSocket;
-      break;
-    case HeadPan:
-      controlChar = 'p';
-      socket = m_headSocket;
-      break;
-    case HeadRoll:
-      controlChar = 'r';
-      socket = m_headSocket;
-      break;
-    case BodyTranslate:
-      controlChar = 'f';
-      socket = m_walkSocket;
-      break;
-    case BodyRotate:
-      controlChar = 'r';
-      socket = m_walkSocket;
-      break;
-    case BodyStrafe:
-      controlChar = 's';
-      socket = m_walkSocket;
-      break;
-    default:
-      qDebug() << "Unknown Control" << control;
-      return;
-      break;
-  }
-  
-  char command[5];
-  command[0] = controlChar.toAscii();
-  command[1] = ((char*)&amount)[0];
-  command[2] = ((char*)&amount)[1];
-  command[3] = ((char*)&amount)[2];
-  command[4] = ((char*)&amount)[3];
-
-  socket->write(command, 5);
+  m_controls->setValue(control, amount);
 }
 void Aibo::set(const QString& property, const QString& value)
 {
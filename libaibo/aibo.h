@@ -5,8 +5,13 @@
 #include <QImage>
 #include <QtNetwork/QAbstractSocket>
 
+#include "camerastream.h"
+#include "ycbcrimage.h"
+
 class QTcpSocket;
 class QMutex;
+class CameraDecoder;
+class ControlScheduler;
 
 class Aibo : public QObject {
   Q_OBJECT
@@ -55,7 +60,27 @@ class Aibo : public QObject {
     bool isHeadControlRunning() const;
     bool isWalkControlRunning() const;
     
+    /** The newest frame as RGB, converted on demand. Call it from the
+        thread the Aibo lives in */
     QImage cameraImage() const;
+    /** The newest frame as decoded. Lock m_dataAccess around the call when
+        calling it from another thread */
+    YCbCrImage cameraYCbCr() const;
+    
+    /** Decode frames at 1/scale of the resolution they are sent at: 1, 2, 4 or 8 */
+    void setCameraDecodeScale(int scale);
+    int cameraDecodeScale() const;
+    
+    int cameraFramesReceived() const; /**< Images that arrived complete */
+    int cameraFramesDropped() const; /**< Images replaced by a newer one before they were decoded */
+    qreal cameraDecodeLatency() const; /**< Milliseconds from the last byte of an image to having it decoded */
+    
+    /** Head and walk control packets are sent at most this many times a
+        second, only for controls whose value changed. 0 sends right away */
+    void setControlRate(int rate);
+    int controlRate() const;
+    int controlPacketsSent() const;
+    qreal controlLatency() const; /**< Average milliseconds from setting a control to sending it */
     
     qreal tilt() const;
     qreal pan() const;
@@ -93,10 +118,13 @@ class Aibo : public QObject {
     
   signals:
     void cameraFrame(QImage frame);
+    /** A new frame is ready, without converting it for display */
+    void cameraFrameReady();
     
   private slots:
     void mainSocketReadyRead();
     void cameraSocketReadyRead();
+    void cameraFrameDecoded(YCbCrImage frame);
     
     void mainSocketError(QAbstractSocket::SocketError error);
     void cameraSocketError(QAbstractSocket::SocketError error);
@@ -113,7 +141,6 @@ class Aibo : public QObject {
     QMutex *m_dataAccess;
     
   private:
-    char* readUntil(QTcpSocket* socket, char stop);
     void sendCommand(const QString &command, QTcpSocket *socket=0);
     void sendControl(Aibo::Control control, float amount);
     void set(const QString &property, const QString &value);
@@ -126,14 +153,16 @@ class Aibo : public QObject {
     QTcpSocket *m_estopSocket;
     
     bool m_cameraRunning;
-    bool m_cameraHeaderStage;
-    int m_cameraFrameSize;
-    int m_newWidth;
-    int m_newHeight;
+    CameraStream m_cameraStream;
+    CameraDecoder *m_cameraDecoder;
+    int m_cameraFramesReceived;
+    ControlScheduler *m_controls;
     bool m_headControlRunning;
     bool m_walkControlRunning;
     
-    QImage m_currentFrame;
+    YCbCrImage m_currentYCbCr;
+    mutable QImage m_currentFrame; // m_currentYCbCr as RGB
+    mutable qint64 m_currentFrameKey; // cacheKey() of the YCbCr frame m_currentFrame shows
 
 };
 
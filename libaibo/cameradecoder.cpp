@@ -0,0 +1,99 @@
+#include "cameradecoder.h"
+#include "trace.h"
+
+#include <QDebug>
+
+CameraDecoder::CameraDecoder(QObject* parent)
+  : QThread(parent),
+    m_hasPending(false),
+    m_stopped(false),
+    m_scale(1)
+{
+  setObjectName("jpeg decoder");
+  qRegisterMetaType<YCbCrImage>();
+}
+
+CameraDecoder::~CameraDecoder()
+{
+  stop();
+}
+
+void CameraDecoder::decode(const CameraPacket& packet)
+{
+  m_pendingAccess.lock();
+  if (m_hasPending) {
+    m_droppedFrames.fetchAndAddRelaxed(1);
+  }
+  m_pending = packet;
+  m_hasPending = true;
+  m_pendingChanged.wakeOne();
+  m_pendingAccess.unlock();
+}
+
+void CameraDecoder::stop()
+{
+  m_pendingAccess.lock();
+  m_stopped = true;
+  m_pendingChanged.wakeOne();
+  m_pendingAccess.unlock();
+  wait();
+  
+  // Ready to be started again
+  m_stopped = false;
+}
+
+void CameraDecoder::setScale(int scale)
+{
+  // libjpeg scales by 1/1, 1/2, 1/4 or 1/8
+  int power = 1;
+  while (power < scale && power < 8) {
+    power *= 2;
+  }
+  m_scale = power;
+}
+int CameraDecoder::scale() const
+{
+  return m_scale;
+}
+
+void CameraDecoder::run()
+{
+  forever {
+    m_pendingAccess.lock();
+    while (!m_hasPending && !m_stopped) {
+      m_pendingChanged.wait(&m_pendingAccess);
+    }
+    if (m_stopped) {
+      m_pendingAccess.unlock();
+      return;
+    }
+    CameraPacket packet = m_pending;
+    m_pending.data = QByteArray();
+    m_hasPending = false;
+    m_pendingAccess.unlock();
+    
+    TRACE_SCOPE("CameraDecoder::decode");
+    YCbCrImage frame;
+    if (!frame.loadJpeg(packet.data, m_scale)) {
+      qDebug() << "Failed decoding frame" << packet.frameNumber << "of size" << packet.data.size();
+      continue;
+    }
+    
+    m_decodeLatency = packet.received.nsecsElapsed() / 1000;
+    m_decodedFrames.fetchAndAddRelaxed(1);
+    emit frameDecoded(frame);
+  }
+}
+
+int CameraDecoder::decodedFrames() const
+{
+  return m_decodedFrames;
+}
+int CameraDecoder::droppedFrames() const
+{
+  return m_droppedFrames;
+}
+qreal CameraDecoder::decodeLatency() const
+{
+  return m_decodeLatency / 1000.0;
+}
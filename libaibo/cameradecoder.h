@@ -0,0 +1,58 @@
+#ifndef AIBO_CAMERADECODER_H
+#define AIBO_CAMERADECODER_H
+
+#include <QThread>
+#include <QImage>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+#include "camerastream.h"
+#include "ycbcrimage.h"
+
+/**
+    Decodes camera images on its own thread, to YCbCr and optionally at a
+    fraction of the size they were sent at. Only the newest image waits
+    for decoding: an image that is replaced before the thread gets to it
+    is dropped. Decoded frames are handed over through the queued
+    frameDecoded() signal, so no lock is held while anyone uses them.
+*/
+class CameraDecoder : public QThread {
+  Q_OBJECT
+  public:
+    CameraDecoder(QObject *parent = 0);
+    ~CameraDecoder();
+    
+    /** Queues an image for decoding, replacing one that is still waiting */
+    void decode(const CameraPacket &packet);
+    /** Stops the thread once the current image is decoded */
+    void stop();
+    
+    /** Decode at 1/scale of the sent size: 1, 2, 4 or 8 */
+    void setScale(int scale);
+    int scale() const;
+    
+    int decodedFrames() const;
+    int droppedFrames() const;
+    qreal decodeLatency() const; /**< Milliseconds from receiving the last image to having it decoded */
+    
+  signals:
+    void frameDecoded(YCbCrImage frame);
+    
+  protected:
+    virtual void run();
+    
+  private:
+    QMutex m_pendingAccess;
+    QWaitCondition m_pendingChanged;
+    CameraPacket m_pending;
+    bool m_hasPending;
+    bool m_stopped;
+    
+    QAtomicInt m_scale;
+    QAtomicInt m_decodedFrames;
+    QAtomicInt m_droppedFrames;
+    QAtomicInt m_decodeLatency; // microseconds
+};
+
+#endif //AIBO_CAMERADECODER_H
@@ -0,0 +1,251 @@
+#include "camerastream.h"
+
+#include <QIODevice>
+#include <QDebug>
+
+// Tekkotsu sends every number as a 4 byte little endian int and every
+// string as its length, the characters and a trailing 0. An image is
+//
+//   "TekkotsuImage" format compression width height timestamp frameNumber
+//   creator chanWidth chanHeight layer chanID
+//   fmt size <size bytes of JPEG>
+
+static const int MaxStringLength = 256;
+// Larger images or channels mean the stream is out of sync
+static const int MaxImageSide = 4096;
+// Room for the JPEG headers on top of 3 bytes a pixel
+static const int MaxJpegOverhead = 4096;
+static const char Magic[] = "TekkotsuImage";
+
+static int littleEndian(const char *buff)
+{
+  int value = 0;
+  value |= (buff[0] & 0xFF) <<  0;
+  value |= (buff[1] & 0xFF) <<  8;
+  value |= (buff[2] & 0xFF) << 16;
+  value |= (buff[3] & 0xFF) << 24;
+  return value;
+}
+
+static void appendInt(QByteArray *out, int value)
+{
+  char buff[4];
+  buff[0] = value >>  0;
+  buff[1] = value >>  8;
+  buff[2] = value >> 16;
+  buff[3] = value >> 24;
+  out->append(buff, 4);
+}
+
+static void appendString(QByteArray *out, const char *string)
+{
+  int length = qstrlen(string);
+  appendInt(out, length);
+  out->append(string, length + 1); // with the trailing 0
+}
+
+CameraStream::CameraStream()
+  : m_state(Header),
+    m_offset(0),
+    m_corrupt(false),
+    m_width(0),
+    m_height(0),
+    m_timestamp(0),
+    m_frameNumber(0),
+    m_imageSize(0)
+{
+  // Room for a few frames. Reserving also keeps resize() from shrinking it
+  m_buffer.reserve(1 << 16);
+}
+
+void CameraStream::readFrom(QIODevice* device)
+{
+  qint64 available = device->bytesAvailable();
+  if (available <= 0) {
+    return;
+  }
+  
+  int size = m_buffer.size();
+  m_buffer.resize(size + available);
+  qint64 read = device->read(m_buffer.data() + size, available);
+  m_buffer.resize(size + qMax(read, qint64(0)));
+}
+
+void CameraStream::append(const char* data, int size)
+{
+  m_buffer.append(data, size);
+}
+
+void CameraStream::clear()
+{
+  m_buffer.resize(0);
+  m_offset = 0;
+  m_state = Header;
+  m_corrupt = false;
+}
+
+bool CameraStream::next(CameraPacket* packet)
+{
+  while (m_state == Header && !parseHeader()) {
+    if (!m_corrupt) {
+      compact();
+      return false;
+    }
+    resync();
+  }
+  
+  if (m_buffer.size() - m_offset < m_imageSize) {
+    compact();
+    return false;
+  }
+  
+  packet->width = m_width;
+  packet->height = m_height;
+  packet->timestamp = m_timestamp;
+  packet->frameNumber = m_frameNumber;
+  packet->data = QByteArray(m_buffer.constData() + m_offset, m_imageSize);
+  packet->received.start();
+  
+  m_offset += m_imageSize;
+  m_state = Header;
+  compact();
+  return true;
+}
+
+QByteArray CameraStream::encode(const CameraPacket& packet)
+{
+  QByteArray out;
+  out.reserve(packet.data.size() + 100);
+  appendString(&out, "TekkotsuImage");
+  appendInt(&out, 0); // format
+  appendInt(&out, 0); // compression
+  appendInt(&out, packet.width);
+  appendInt(&out, packet.height);
+  appendInt(&out, packet.timestamp);
+  appendInt(&out, packet.frameNumber);
+  appendString(&out, "FbkImage");
+  appendInt(&out, packet.width); // chanWidth
+  appendInt(&out, packet.height); // chanHeight
+  appendInt(&out, 0); // layer
+  appendInt(&out, 0); // chanID
+  appendString(&out, "JPEGColor");
+  appendInt(&out, packet.data.size());
+  out.append(packet.data);
+  return out;
+}
+
+// Walks the header without consuming anything until all of it is there.
+// Headers are less than 100 bytes, so starting over is cheap.
+bool CameraStream::parseHeader()
+{
+  int pos = m_offset;
+  int format, compression, chanWidth, chanHeight, layer, chanID;
+  
+  bool complete = matchString(&pos, Magic)
+               && readInt(&pos, &format)
+               && readInt(&pos, &compression)
+               && readInt(&pos, &m_width)
+               && readInt(&pos, &m_height)
+               && readInt(&pos, &m_timestamp)
+               && readInt(&pos, &m_frameNumber)
+               && skipString(&pos) // creator, "FbkImage"
+               && readInt(&pos, &chanWidth)
+               && readInt(&pos, &chanHeight)
+               && readInt(&pos, &layer)
+               && readInt(&pos, &chanID)
+               && skipString(&pos) // fmt, "JPEGColor"
+               && readInt(&pos, &m_imageSize);
+  if (!complete) {
+    return false;
+  }
+  if (m_width <= 0 || m_width > MaxImageSide || m_height <= 0 || m_height > MaxImageSide
+      || chanWidth <= 0 || chanWidth > MaxImageSide || chanHeight <= 0 || chanHeight > MaxImageSide
+      || m_imageSize < 0 || m_imageSize > chanWidth*chanHeight*3 + MaxJpegOverhead) {
+    m_corrupt = true;
+    return false;
+  }
+  
+  m_offset = pos;
+  m_state = Image;
+  return true;
+}
+
+bool CameraStream::readInt(int* pos, int* value) const
+{
+  if (m_buffer.size() - *pos < 4) {
+    return false;
+  }
+  *value = littleEndian(m_buffer.constData() + *pos);
+  *pos += 4;
+  return true;
+}
+
+bool CameraStream::skipString(int* pos)
+{
+  int length;
+  if (!readInt(pos, &length)) {
+    return false;
+  }
+  if (length < 0 || length > MaxStringLength) {
+    m_corrupt = true;
+    return false;
+  }
+  if (m_buffer.size() - *pos < length + 1) {
+    return false;
+  }
+  *pos += length + 1;
+  return true;
+}
+
+// Like skipString(), but the string has to be the expected one
+bool CameraStream::matchString(int* pos, const char* expected)
+{
+  int start = *pos;
+  if (!skipString(pos)) {
+    return false;
+  }
+  int length = qstrlen(expected);
+  if (*pos - start != 4 + length + 1
+      || qstrncmp(m_buffer.constData() + start + 4, expected, length) != 0) {
+    m_corrupt = true;
+    return false;
+  }
+  return true;
+}
+
+// Skips to the next "TekkotsuImage" after a bad header. Without one, the
+// tail that could be the start of it is kept
+void CameraStream::resync()
+{
+  QByteArray magic;
+  appendString(&magic, Magic);
+  int found = m_buffer.indexOf(magic, m_offset + 1);
+  int dropped;
+  if (found >= 0) {
+    dropped = found - m_offset;
+    m_offset = found;
+  } else {
+    // At least the byte the bad header started on goes
+    int keep = qMin(m_buffer.size() - m_offset - 1, magic.size() - 1);
+    dropped = m_buffer.size() - keep - m_offset;
+    m_offset = m_buffer.size() - keep;
+  }
+  qDebug() << "Corrupt camera stream, skipped" << dropped << "bytes";
+  m_corrupt = false;
+}
+
+// Moves the unparsed bytes to the front once the parsed ones take up at
+// least half the buffer, so the buffer doesn't grow and we rarely copy
+void CameraStream::compact()
+{
+  if (m_offset == 0) {
+    return;
+  }
+  if (m_offset == m_buffer.size()) {
+    m_buffer.resize(0);
+    m_offset = 0;
+  } else if (m_offset >= m_buffer.size()/2) {
+    m_buffer.remove(0, m_offset);
+    m_offset = 0;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef AIBO_CAMERASTREAM_H
+#define AIBO_CAMERASTREAM_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+class QIODevice;
+
+/** One image from the Tekkotsu raw camera server, still compressed */
+struct CameraPacket {
+  int width;
+  int height;
+  int timestamp; /**< Milliseconds on the robot */
+  int frameNumber;
+  QByteArray data; /**< JPEG */
+  QElapsedTimer received; /**< Started when the last byte arrived */
+};
+
+/**
+    Incremental parser for the Tekkotsu raw camera stream. Bytes are
+    appended to one contiguous buffer as they arrive and the header fields
+    are read in place, so nothing is allocated per field. The only
+    allocation per image is the copy of its compressed data.
+*/
+class CameraStream {
+  public:
+    CameraStream();
+
+    /** Appends everything the device has buffered */
+    void readFrom(QIODevice *device);
+    void append(const char *data, int size);
+
+    /** Parses the next complete image out of the buffer. Returns false if
+        more bytes are needed */
+    bool next(CameraPacket *packet);
+
+    /** Drops everything buffered, e.g. after reconnecting */
+    void clear();
+
+    /** Serializes an image the way the raw camera server sends it */
+    static QByteArray encode(const CameraPacket &packet);
+
+  private:
+    enum State {
+      Header,
+      Image
+    };
+
+    bool parseHeader();
+    bool readInt(int *pos, int *value) const;
+    bool skipString(int *pos);
+    bool matchString(int *pos, const char *expected);
+    void resync();
+    void compact();
+
+    State m_state;
+    QByteArray m_buffer;
+    int m_offset; // start of the unparsed bytes in m_buffer
+    bool m_corrupt;
+
+    int m_width;
+    int m_height;
+    int m_timestamp;
+    int m_frameNumber;
+    int m_imageSize;
+};
+
+#endif //AIBO_CAMERASTREAM_H
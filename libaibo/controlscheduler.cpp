@@ -0,0 +1,176 @@
+#include "controlscheduler.h"
+
+#include <QtNetwork/QAbstractSocket>
+#include <QByteArray>
+#include <QDebug>
+
+ControlScheduler::ControlScheduler(QObject* parent)
+  : QObject(parent),
+    m_rate(0),
+    m_packetsSent(0),
+    m_commandsCoalesced(0),
+    m_commandsSkipped(0),
+    m_latencySum(0),
+    m_latencyMax(0)
+{
+  m_timer.setSingleShot(true);
+  connect(&m_timer, SIGNAL(timeout()), SLOT(flush()));
+  m_lastFlush.start();
+  setRate(30);
+}
+
+ControlScheduler::~ControlScheduler()
+{
+}
+
+void ControlScheduler::addChannel(int channel, QAbstractSocket* socket, char command)
+{
+  if (channel >= m_channels.size()) {
+    m_channels.resize(channel + 1);
+  }
+
+  Channel added;
+  added.socket = socket;
+  added.command = command;
+  m_channels[channel] = added;
+
+  // Values set before the socket connected go out as soon as it does
+  connect(socket, SIGNAL(connected()), SLOT(socketConnected()), Qt::UniqueConnection);
+}
+
+void ControlScheduler::setValue(int channel, float value)
+{
+  if (channel < 0 || channel >= m_channels.size() || m_channels[channel].socket == 0) {
+    qDebug() << "Unknown control channel" << channel;
+    return;
+  }
+
+  Channel &control = m_channels[channel];
+  if (control.pending) {
+    m_commandsCoalesced++;
+    control.value = value;
+    if (control.sent && control.sentValue == value) {
+      // Back to what the robot already has
+      control.pending = false;
+    }
+    return;
+  }
+  if (control.sent && control.sentValue == value) {
+    m_commandsSkipped++;
+    return;
+  }
+
+  control.value = value;
+  control.pending = true;
+  control.requested.start();
+  schedule();
+}
+
+// Flushes right away if the last flush is at least one period ago,
+// otherwise once the period is over
+void ControlScheduler::schedule()
+{
+  if (m_timer.isActive()) {
+    return;
+  }
+  int period = m_rate > 0 ? 1000 / m_rate : 0;
+  int wait = period - m_lastFlush.elapsed();
+  if (wait <= 0) {
+    flush();
+  } else {
+    m_timer.start(wait);
+  }
+}
+
+void ControlScheduler::flush()
+{
+  m_timer.stop();
+  m_lastFlush.start();
+
+  // Gather the packets of each socket into one write
+  QList<QAbstractSocket*> sockets;
+  QList<QByteArray> packets;
+  for (int i=0; i<m_channels.size(); i++) {
+    Channel &control = m_channels[i];
+    if (!control.pending || control.socket->state() != QAbstractSocket::ConnectedState) {
+      continue;
+    }
+
+    int index = sockets.indexOf(control.socket);
+    if (index < 0) {
+      index = sockets.size();
+      sockets.append(control.socket);
+      packets.append(QByteArray());
+    }
+    packets[index].append(control.command);
+    packets[index].append((const char*)&control.value, 4);
+
+    qint64 latency = control.requested.nsecsElapsed() / 1000;
+    m_latencySum += latency;
+    m_latencyMax = qMax(m_latencyMax, latency);
+    m_packetsSent++;
+
+    control.pending = false;
+    control.sent = true;
+    control.sentValue = control.value;
+  }
+
+  for (int i=0; i<sockets.size(); i++) {
+    sockets[i]->write(packets[i]);
+  }
+}
+
+void ControlScheduler::forget(QAbstractSocket* socket)
+{
+  for (int i=0; i<m_channels.size(); i++) {
+    if (m_channels[i].socket == socket) {
+      m_channels[i].sent = false;
+    }
+  }
+}
+
+void ControlScheduler::socketConnected()
+{
+  QAbstractSocket *socket = qobject_cast<QAbstractSocket*>(sender());
+  forget(socket);
+
+  for (int i=0; i<m_channels.size(); i++) {
+    if (m_channels[i].socket == socket && m_channels[i].pending) {
+      schedule();
+      return;
+    }
+  }
+}
+
+void ControlScheduler::setRate(int rate)
+{
+  m_rate = qMax(rate, 0);
+}
+int ControlScheduler::rate() const
+{
+  return m_rate;
+}
+
+int ControlScheduler::packetsSent() const
+{
+  return m_packetsSent;
+}
+int ControlScheduler::commandsCoalesced() const
+{
+  return m_commandsCoalesced;
+}
+int ControlScheduler::commandsSkipped() const
+{
+  return m_commandsSkipped;
+}
+qreal ControlScheduler::averageLatency() const
+{
+  if (m_packetsSent == 0) {
+    return 0;
+  }
+  return m_latencySum / 1000.0 / m_packetsSent;
+}
+qreal ControlScheduler::maxLatency() const
+{
+  return m_latencyMax / 1000.0;
+}
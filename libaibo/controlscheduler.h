@@ -0,0 +1,78 @@
+#ifndef AIBO_CONTROLSCHEDULER_H
+#define AIBO_CONTROLSCHEDULER_H
+
+#include <QObject>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class QAbstractSocket;
+
+/**
+    Rate limits the remote control packets sent to the robot. Only the
+    latest value of each control is kept, values that equal what was last
+    sent are skipped, and everything that changed is flushed at most
+    rate() times a second with one write per socket.
+
+    Each control is a channel: a command character sent on a socket,
+    followed by the value as a 4 byte float.
+*/
+class ControlScheduler : public QObject {
+  Q_OBJECT
+  public:
+    ControlScheduler(QObject *parent = 0);
+    ~ControlScheduler();
+
+    /** Registers control number channel, sent as command on socket */
+    void addChannel(int channel, QAbstractSocket *socket, char command);
+
+    /** Sets the value to send on a channel with the next flush */
+    void setValue(int channel, float value);
+
+    /** Flushes per second. 0 sends every value right away */
+    void setRate(int rate);
+    int rate() const;
+
+    int packetsSent() const;
+    int commandsCoalesced() const; /**< Values replaced before they were sent */
+    int commandsSkipped() const; /**< Values equal to the one last sent */
+    qreal averageLatency() const; /**< Milliseconds from setValue() to the write */
+    qreal maxLatency() const;
+
+  public slots:
+    /** Sends all pending values on sockets that are connected */
+    void flush();
+    /** Forgets what was sent on a socket, e.g. because it reconnected */
+    void forget(QAbstractSocket *socket);
+
+  private slots:
+    void socketConnected();
+
+  private:
+    struct Channel {
+      Channel() : socket(0), command(0), value(0), sentValue(0), pending(false), sent(false) {}
+
+      QAbstractSocket *socket;
+      char command;
+      float value;
+      float sentValue;
+      bool pending;
+      bool sent; // sentValue is valid
+      QElapsedTimer requested; // since the oldest unsent value
+    };
+
+    void schedule();
+
+    QVector<Channel> m_channels;
+    QTimer m_timer;
+    QElapsedTimer m_lastFlush;
+    int m_rate;
+
+    int m_packetsSent;
+    int m_commandsCoalesced;
+    int m_commandsSkipped;
+    qint64 m_latencySum; // microseconds
+    qint64 m_latencyMax;
+};
+
+#endif //AIBO_CONTROLSCHEDULER_H
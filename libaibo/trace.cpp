@@ -0,0 +1,150 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+const int Trace::EventsPerThread;
+volatile bool Trace::s_enabled = false;
+
+namespace {
+
+  struct TraceEvent {
+    const char *name;
+    qint64 begin;
+    qint64 end;
+  };
+
+  /** Written by one thread only. next is published after the event
+      before it, so save() can read a ring that is still being filled */
+  struct TraceBuffer {
+    TraceEvent *events;
+    QAtomicInt next;
+    volatile bool wrapped;
+    int thread;
+    QString name;
+  };
+
+}
+
+static QMutex s_buffersAccess;
+static QList<TraceBuffer*> s_buffers;
+static qint64 s_started = 0;
+
+// Scopes entered before save() still record when they are left. Their
+// events overwrite the oldest ones of a full ring, which save() skips
+static const int SaveMargin = 256;
+
+static __thread TraceBuffer *t_buffer = 0;
+
+static TraceBuffer* createBuffer()
+{
+  TraceBuffer *buffer = new TraceBuffer;
+  buffer->events = new TraceEvent[Trace::EventsPerThread];
+  buffer->wrapped = false;
+
+  QThread *thread = QThread::currentThread();
+  buffer->name = thread->objectName();
+  if (buffer->name.isEmpty()) {
+    if (QCoreApplication::instance() && thread == QCoreApplication::instance()->thread()) {
+      buffer->name = "main";
+    } else {
+      buffer->name = thread->metaObject()->className();
+    }
+  }
+
+  s_buffersAccess.lock();
+  buffer->thread = s_buffers.size() + 1;
+  s_buffers.append(buffer);
+  s_buffersAccess.unlock();
+  return buffer;
+}
+
+void Trace::start()
+{
+  s_started = now();
+  s_enabled = true;
+}
+
+void Trace::record(const char* name, qint64 begin, qint64 end)
+{
+  if (!t_buffer) {
+    t_buffer = createBuffer();
+  }
+  TraceBuffer *buffer = t_buffer;
+  int index = buffer->next;
+  TraceEvent &event = buffer->events[index];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  if (index == EventsPerThread - 1) {
+    buffer->wrapped = true;
+  }
+  buffer->next.fetchAndStoreRelease((index + 1) & (EventsPerThread - 1));
+}
+
+static QString escaped(QString text)
+{
+  return text.replace('\\', "\\\\").replace('"', "\\\"");
+}
+
+bool Trace::save(const QString& fileName)
+{
+  s_enabled = false;
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning() << "Could not write trace" << fileName << ":" << file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  out << "{\"traceEvents\":[\n";
+
+  // Timestamps and durations are in microseconds
+  bool first = true;
+  int events = 0;
+  int wrapped = 0;
+  s_buffersAccess.lock();
+  foreach (TraceBuffer *buffer, s_buffers) {
+    out << (first ? "" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread
+        << ",\"args\":{\"name\":\"" << escaped(buffer->name) << "\"}}";
+    first = false;
+
+    // Oldest first
+    int next = buffer->next.fetchAndAddAcquire(0);
+    int oldest = 0;
+    int count = next;
+    if (buffer->wrapped) {
+      oldest = next + SaveMargin;
+      count = EventsPerThread - SaveMargin;
+      wrapped++;
+    }
+    for (int i=0; i<count; i++) {
+      const TraceEvent &event = buffer->events[(oldest + i) & (EventsPerThread - 1)];
+      out << ",\n{\"name\":\"" << escaped(QString::fromLatin1(event.name))
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread
+          << ",\"ts\":" << QString::number((event.begin - s_started) / 1000.0, 'f', 3)
+          << ",\"dur\":" << QString::number((event.end - event.begin) / 1000.0, 'f', 3) << "}";
+    }
+    events += count;
+  }
+  s_buffersAccess.unlock();
+
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.flush();
+  if (file.error() != QFile::NoError) {
+    qWarning() << "Could not write trace" << fileName << ":" << file.errorString();
+    return false;
+  }
+
+  qDebug() << "Wrote" << events << "trace events to" << fileName;
+  if (wrapped > 0) {
+    qWarning() << "Only the last" << EventsPerThread << "events of" << wrapped << "threads were kept";
+  }
+  return true;
+}
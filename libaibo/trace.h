@@ -0,0 +1,80 @@
+#ifndef AIBO_TRACE_H
+#define AIBO_TRACE_H
+
+#include <QString>
+#include <QAtomicInt>
+
+#include <time.h>
+
+/**
+    A timeline of what every thread was doing, written as Chrome
+    trace_event JSON for chrome://tracing or https://ui.perfetto.dev.
+
+    Each thread records into a ring of its own, so recording takes no
+    lock: a scope reads the clock when it is entered and when it is left
+    and stores both with a pointer to its name. A ring holds the last
+    Trace::EventsPerThread events of its thread, older ones are
+    overwritten, so a long run saves the end of its timeline. Nothing is
+    recorded until start() is called, before the threads to trace are
+    started:
+
+      Trace::start();
+      ...
+      { TRACE_SCOPE("GrowingNeuralGas::runSingleStep"); ... }
+      ...
+      Trace::save("out.json");
+
+    Threads are named after their objectName(), or their class if they
+    have none.
+*/
+class Trace {
+  public:
+    static const int EventsPerThread = 1 << 18; /**< A power of two, 6 MB per thread */
+
+    /** Starts recording on every thread */
+    static void start();
+    /** Stops recording and writes everything recorded so far */
+    static bool save(const QString &fileName);
+
+    static bool enabled() { return s_enabled; }
+
+    /** Nanoseconds on the monotonic clock */
+    static qint64 now()
+    {
+      timespec now;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      return qint64(now.tv_sec)*1000000000 + now.tv_nsec;
+    }
+
+    /** Records that the calling thread spent begin to end in name. The
+        name has to outlive the trace, normally it is a string literal */
+    static void record(const char *name, qint64 begin, qint64 end);
+
+  private:
+    static volatile bool s_enabled;
+};
+
+/** Records the time from its construction to its destruction */
+class TraceScope {
+  public:
+    TraceScope(const char *name)
+      : m_name(Trace::enabled() ? name : 0),
+        m_begin(m_name ? Trace::now() : 0) {}
+    ~TraceScope()
+    {
+      if (m_name) {
+        Trace::record(m_name, m_begin, Trace::now());
+      }
+    }
+
+  private:
+    const char *m_name;
+    qint64 m_begin;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+/** Traces the rest of the enclosing block */
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif //AIBO_TRACE_H
@@ -0,0 +1,201 @@
+#include "ycbcrimage.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+
+#include <stdio.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+// libjpeg reports errors by calling error_exit, which must not return
+struct JpegError {
+  jpeg_error_mgr manager;
+  jmp_buf jump;
+};
+
+static void jpegErrorExit(j_common_ptr info)
+{
+  JpegError *error = (JpegError*)info->err;
+  char message[JMSG_LENGTH_MAX];
+  (*info->err->format_message)(info, message);
+  qDebug() << "JPEG error:" << message;
+  longjmp(error->jump, 1);
+}
+
+static void jpegNoMessage(j_common_ptr)
+{
+  // Camera frames are often missing a few bytes at the end, don't warn
+}
+
+// The memory source manager only arrived in libjpeg 8, so bring our own
+static void sourceInit(j_decompress_ptr) {}
+static void sourceTerm(j_decompress_ptr) {}
+static boolean sourceFill(j_decompress_ptr info)
+{
+  // Out of data: feed an EOI marker so that libjpeg finishes the frame
+  static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+  info->src->next_input_byte = eoi;
+  info->src->bytes_in_buffer = 2;
+  return TRUE;
+}
+static void sourceSkip(j_decompress_ptr info, long count)
+{
+  if (count > (long)info->src->bytes_in_buffer) {
+    sourceFill(info);
+  } else if (count > 0) {
+    info->src->next_input_byte += count;
+    info->src->bytes_in_buffer -= count;
+  }
+}
+
+static qint64 nextCacheKey()
+{
+  static QAtomicInt serial;
+  return serial.fetchAndAddRelaxed(1) + 1;
+}
+
+YCbCrImage::YCbCrImage()
+  : m_width(0),
+    m_height(0),
+    m_cacheKey(0)
+{
+}
+
+YCbCrImage::YCbCrImage(int width, int height)
+  : m_width(width),
+    m_height(height),
+    m_cacheKey(nextCacheKey())
+{
+  // Y=0, Cb=Cr=128
+  m_data.resize(3*width*height);
+  uchar *pixel = (uchar*)m_data.data();
+  for (int i=0; i<width*height; i++) {
+    *pixel++ = 0;
+    *pixel++ = 128;
+    *pixel++ = 128;
+  }
+}
+
+// Only plain C data lives in this function, since longjmp() skips destructors
+static bool decodeJpeg(const QByteArray &jpeg, int scale, QByteArray *data, int *width, int *height)
+{
+  jpeg_decompress_struct info;
+  JpegError error;
+  info.err = jpeg_std_error(&error.manager);
+  error.manager.error_exit = jpegErrorExit;
+  error.manager.output_message = jpegNoMessage;
+  if (setjmp(error.jump)) {
+    jpeg_destroy_decompress(&info);
+    return false;
+  }
+
+  jpeg_create_decompress(&info);
+
+  jpeg_source_mgr source;
+  source.init_source = sourceInit;
+  source.fill_input_buffer = sourceFill;
+  source.skip_input_data = sourceSkip;
+  source.resync_to_restart = jpeg_resync_to_restart;
+  source.term_source = sourceTerm;
+  source.next_input_byte = (const JOCTET*)jpeg.constData();
+  source.bytes_in_buffer = jpeg.size();
+  info.src = &source;
+
+  jpeg_read_header(&info, TRUE);
+
+  bool gray = info.jpeg_color_space == JCS_GRAYSCALE;
+  info.out_color_space = gray ? JCS_GRAYSCALE : JCS_YCbCr;
+  info.scale_num = 1;
+  info.scale_denom = scale;
+  // The GNG samples single pixels, it doesn't need the accurate DCT
+  info.dct_method = JDCT_IFAST;
+  jpeg_start_decompress(&info);
+
+  *width = info.output_width;
+  *height = info.output_height;
+  data->resize(3*info.output_width*info.output_height);
+  uchar *line = (uchar*)data->data();
+  while (info.output_scanline < info.output_height) {
+    JSAMPROW row = line;
+    jpeg_read_scanlines(&info, &row, 1);
+    if (gray) {
+      // Spread the luma in place, back to front
+      for (int x=info.output_width-1; x>=0; x--) {
+        line[3*x] = line[x];
+        line[3*x + 1] = 128;
+        line[3*x + 2] = 128;
+      }
+    }
+    line += 3*info.output_width;
+  }
+
+  jpeg_finish_decompress(&info);
+  jpeg_destroy_decompress(&info);
+  return true;
+}
+
+bool YCbCrImage::loadJpeg(const QByteArray& jpeg, int scale)
+{
+  QByteArray data;
+  int width, height;
+  if (!decodeJpeg(jpeg, scale, &data, &width, &height)) {
+    return false;
+  }
+
+  m_width = width;
+  m_height = height;
+  m_data = data;
+  m_cacheKey = nextCacheKey();
+  return true;
+}
+
+bool YCbCrImage::isNull() const
+{
+  return m_width == 0 || m_height == 0;
+}
+int YCbCrImage::width() const
+{
+  return m_width;
+}
+int YCbCrImage::height() const
+{
+  return m_height;
+}
+int YCbCrImage::bytesPerLine() const
+{
+  return 3*m_width;
+}
+const uchar* YCbCrImage::constBits() const
+{
+  return (const uchar*)m_data.constData();
+}
+qint64 YCbCrImage::cacheKey() const
+{
+  return m_cacheKey;
+}
+
+static inline int clampChannel(int value)
+{
+  return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+QImage YCbCrImage::toImage() const
+{
+  QImage image(m_width, m_height, QImage::Format_RGB32);
+  const uchar *pixel = constBits();
+  for (int y=0; y<m_height; y++) {
+    QRgb *line = (QRgb*)image.scanLine(y);
+    for (int x=0; x<m_width; x++) {
+      // JFIF conversion in 16.16 fixed point
+      int luma = pixel[0] << 16;
+      int cb = pixel[1] - 128;
+      int cr = pixel[2] - 128;
+      int red = (luma + 91881*cr + 32768) >> 16;
+      int green = (luma - 22554*cb - 46802*cr + 32768) >> 16;
+      int blue = (luma + 116130*cb + 32768) >> 16;
+      line[x] = qRgb(clampChannel(red), clampChannel(green), clampChannel(blue));
+      pixel += 3;
+    }
+  }
+  return image;
+}
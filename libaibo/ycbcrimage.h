@@ -0,0 +1,44 @@
+#ifndef AIBO_YCBCRIMAGE_H
+#define AIBO_YCBCRIMAGE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMetaType>
+
+/**
+    A decoded camera frame in the JPEG's own color space: interleaved 8 bit
+    Y, Cb and Cr. Decoding to YCbCr skips libjpeg's RGB conversion, and
+    the GNG sources convert straight from it to HSL. Copies share the
+    pixel data, like QImage.
+*/
+class YCbCrImage {
+  public:
+    YCbCrImage();
+    YCbCrImage(int width, int height); /**< A black frame */
+
+    /** Decodes a JPEG at 1/scale of its size (scale is 1, 2, 4 or 8).
+        Scaling happens in the DCT, so smaller sizes decode faster */
+    bool loadJpeg(const QByteArray &jpeg, int scale = 1);
+
+    bool isNull() const;
+    int width() const;
+    int height() const;
+    int bytesPerLine() const;
+    const uchar* constBits() const;
+
+    /** Identifies the decoded frame, like QImage::cacheKey() */
+    qint64 cacheKey() const;
+
+    /** Converts to QImage::Format_RGB32 for display */
+    QImage toImage() const;
+
+  private:
+    int m_width;
+    int m_height;
+    QByteArray m_data;
+    qint64 m_cacheKey;
+};
+
+Q_DECLARE_METATYPE(YCbCrImage)
+
+#endif //AIBO_YCBCRIMAGE_H
@@ -1,13 +1,14 @@
 #include "aibosource.h"
 
-#include <QColor>
+#include <QImage>
 #include <QtNetwork/QTcpSocket>
 #include <QMutex>
 
 using namespace GNG;
 
 AiboSource::AiboSource(const QString& hostname, QObject* parent)
-  : Aibo(hostname, parent)
+  : Aibo(hostname, parent),
+    m_convertedFrame(0)
 {
 }
 
@@ -25,23 +26,33 @@ Point AiboSource::generatePoint()
   m_dataAccess->lock();
   
   if (!isCameraRunning()) {
+    m_dataAccess->unlock();
     Point p(dimension());
     p.fill(0);
     return p;
   }
-  int x = qrand() % cameraImage().width();
-  int y = qrand() % cameraImage().height();
   
-  QColor rgb = cameraImage().pixel(x, y);
-  QColor hsl = rgb.toHsl();
+  // Convert each frame once, the first time it is sampled, straight from
+  // the decoded YCbCr
+  YCbCrImage frame = cameraYCbCr();
+  if (frame.cacheKey() != m_convertedFrame) {
+    m_hsl.convertYCbCr(frame.constBits(), frame.width(), frame.height(), frame.bytesPerLine());
+    m_convertedFrame = frame.cacheKey();
+  }
+  m_dataAccess->unlock();
   
-  Point p(dimension());
-  p[0] = normalize(x, cameraImage().width());
-  p[1] = normalize(y, cameraImage().height());
+  int x = qrand() % m_hsl.width();
+  int y = qrand() % m_hsl.height();
   
-  hsl.getHslF(&p[2], &p[3], &p[4]);
+  Point p(dimension());
+  p[0] = normalize(x, m_hsl.width());
+  p[1] = normalize(y, m_hsl.height());
   
-  m_dataAccess->unlock();
+  m_hsl.hsl(x, y, &p[2], &p[3], &p[4]);
   return p;
 }
 
+qint64 AiboSource::sampledFrame() const
+{
+  return m_convertedFrame;
+}
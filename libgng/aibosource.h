@@ -6,6 +6,7 @@
 #include <libaibo/aibo.h>
 
 #include "pointsource.h"
+#include "hslimage.h"
 
 namespace GNG {
 
@@ -17,6 +18,13 @@ namespace GNG {
       
       virtual int dimension();
       virtual Point generatePoint();
+      
+      /** cacheKey() of the YCbCr camera frame the last point was drawn from */
+      qint64 sampledFrame() const;
+      
+    private:
+      HslImage m_hsl;
+      qint64 m_convertedFrame; // cacheKey() of the YCbCr frame in m_hsl
   };
   
 }
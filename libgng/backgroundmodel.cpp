@@ -0,0 +1,196 @@
+#include "backgroundmodel.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <QDebug>
+
+using namespace GNG;
+
+BackgroundModel::BackgroundModel(Mode mode)
+  : m_mode(mode),
+    m_color(Qt::white),
+    m_tolerance(50),
+    m_learnRate(0.05),
+    m_width(0),
+    m_height(0),
+    m_meanInitialized(false)
+{
+}
+
+BackgroundModel::~BackgroundModel()
+{
+}
+
+BackgroundModel::Mode BackgroundModel::modeFromName(const QString& name, bool* ok)
+{
+  if (ok) {
+    *ok = true;
+  }
+  if (name == "none") {
+    return None;
+  } else if (name == "color") {
+    return FixedColor;
+  } else if (name == "learned") {
+    return RunningMean;
+  }
+
+  if (ok) {
+    *ok = false;
+  }
+  return None;
+}
+
+void BackgroundModel::reset()
+{
+  m_width = 0;
+  m_height = 0;
+  m_meanInitialized = false;
+  m_mean.clear();
+  m_mask.clear();
+  m_foreground.clear();
+}
+
+// Decides whether a single pixel is foreground and, for the running mean,
+// folds the pixel into the mean. Returns true for foreground pixels.
+bool BackgroundModel::classify(int index, int blue, int green, int red)
+{
+  switch (m_mode) {
+    case FixedColor:
+      return abs(blue - m_color.blue()) > m_tolerance
+          || abs(green - m_color.green()) > m_tolerance
+          || abs(red - m_color.red()) > m_tolerance;
+
+    case RunningMean: {
+      float *mean = m_mean.data() + 3*index;
+      if (!m_meanInitialized) {
+        mean[0] = blue;
+        mean[1] = green;
+        mean[2] = red;
+        return false;
+      }
+      bool foreground = fabsf(blue - mean[0]) > m_tolerance
+                     || fabsf(green - mean[1]) > m_tolerance
+                     || fabsf(red - mean[2]) > m_tolerance;
+      mean[0] += m_learnRate*(blue - mean[0]);
+      mean[1] += m_learnRate*(green - mean[1]);
+      mean[2] += m_learnRate*(red - mean[2]);
+      return foreground;
+    }
+
+    case None:
+    default:
+      return true;
+  }
+}
+
+void BackgroundModel::update(const uchar* data, int width, int height, int bytesPerLine, int bytesPerPixel)
+{
+  if (m_mode == None) {
+    // Nothing to classify, sources sample uniformly
+    m_foreground.resize(0);
+    return;
+  }
+
+  if (width != m_width || height != m_height) {
+    reset();
+    m_width = width;
+    m_height = height;
+    m_mask.resize(width*height);
+    if (m_mode == RunningMean) {
+      m_mean.resize(3*width*height);
+    }
+  }
+  if (m_mode == RunningMean && m_mean.size() != 3*width*height) {
+    // The mode was switched after the first frame
+    m_mean.resize(3*width*height);
+    m_meanInitialized = false;
+  }
+
+  m_foreground.resize(0);
+  uchar *mask = m_mask.data();
+
+  for (int y=0; y<height; y++) {
+    const uchar *pixel = data + y*bytesPerLine;
+    for (int x=0; x<width; x++) {
+      int index = y*width + x;
+      bool foreground = classify(index, pixel[0], pixel[1], pixel[2]);
+      mask[index] = foreground;
+      if (foreground) {
+        m_foreground.append(index);
+      }
+      pixel += bytesPerPixel;
+    }
+  }
+
+  if (m_mode == RunningMean) {
+    m_meanInitialized = true;
+  }
+}
+
+void BackgroundModel::update(const QImage& image)
+{
+  if (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32) {
+    // 0xAARRGGBB words, so the bytes are stored as B G R A on little endian machines
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    update(image.bits(), image.width(), image.height(), image.bytesPerLine(), 4);
+    return;
+#endif
+  }
+
+  QImage rgb = image.convertToFormat(QImage::Format_RGB32);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  update(rgb.bits(), rgb.width(), rgb.height(), rgb.bytesPerLine(), 4);
+#else
+  // Repack as BGR so that we can share the classification loop
+  QVector<uchar> bgr(3*rgb.width()*rgb.height());
+  uchar *out = bgr.data();
+  for (int y=0; y<rgb.height(); y++) {
+    const QRgb *line = (const QRgb*)rgb.constScanLine(y);
+    for (int x=0; x<rgb.width(); x++) {
+      *out++ = qBlue(line[x]);
+      *out++ = qGreen(line[x]);
+      *out++ = qRed(line[x]);
+    }
+  }
+  update(bgr.constData(), rgb.width(), rgb.height(), 3*rgb.width(), 3);
+#endif
+}
+
+bool BackgroundModel::isForeground(int x, int y) const
+{
+  if (m_mask.isEmpty()) {
+    return true;
+  }
+  return m_mask.at(y*m_width + x);
+}
+
+int BackgroundModel::foregroundCount() const
+{
+  return m_foreground.size();
+}
+
+bool BackgroundModel::randomForegroundPixel(int* x, int* y) const
+{
+  if (m_mode == None || m_foreground.isEmpty()) {
+    return false;
+  }
+
+  int index = m_foreground.at(qrand() % m_foreground.size());
+  *x = index % m_width;
+  *y = index / m_width;
+  return true;
+}
+
+
+// Getters
+BackgroundModel::Mode BackgroundModel::mode() const { return m_mode; }
+QColor BackgroundModel::color() const { return m_color; }
+int BackgroundModel::tolerance() const { return m_tolerance; }
+qreal BackgroundModel::learnRate() const { return m_learnRate; }
+
+// Setters
+void BackgroundModel::setMode(Mode mode) { m_mode = mode; }
+void BackgroundModel::setColor(const QColor& color) { m_color = color.toRgb(); }
+void BackgroundModel::setTolerance(int tolerance) { m_tolerance = tolerance; }
+void BackgroundModel::setLearnRate(qreal learnRate) { m_learnRate = learnRate; }
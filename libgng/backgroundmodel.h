@@ -0,0 +1,80 @@
+#ifndef GNG_BACKGROUNDMODEL_H
+#define GNG_BACKGROUNDMODEL_H
+
+#include <QColor>
+#include <QImage>
+#include <QString>
+#include <QVector>
+
+namespace GNG {
+
+  /**
+      Splits the pixels of a frame into background and foreground so that
+      sources only hand foreground pixels to the GNG. The background is
+      either a fixed color with a tolerance or a per-pixel running mean
+      that is learned over consecutive (camera) frames.
+
+      The mask is computed once per frame in update(). Sampling then draws
+      directly from the list of foreground pixels instead of rejecting
+      background pixels one at a time.
+  */
+  class BackgroundModel {
+
+    public:
+      enum Mode {
+        None,        /**< Every pixel is foreground */
+        FixedColor,  /**< Pixels within tolerance() of color() are background */
+        RunningMean  /**< Pixels within tolerance() of their running mean are background */
+      };
+
+      BackgroundModel(Mode mode = None);
+      ~BackgroundModel();
+
+      /** Parses "none", "color" or "learned". Returns None and sets ok to false otherwise */
+      static Mode modeFromName(const QString &name, bool *ok = 0);
+
+      Mode mode() const;
+      QColor color() const;
+      int tolerance() const;
+      qreal learnRate() const;
+
+      void setMode(Mode mode);
+      void setColor(const QColor &color); /**< Background color used by FixedColor */
+      void setTolerance(int tolerance); /**< Max per channel difference (0-255) that still counts as background */
+      void setLearnRate(qreal learnRate); /**< Weight of the newest frame in the RunningMean */
+
+      /** Recomputes the foreground mask from a frame of 8 bit pixels stored
+          in BGR order, bytesPerPixel apart (3 for OpenCV frames) */
+      void update(const uchar *data, int width, int height, int bytesPerLine, int bytesPerPixel);
+      /** Recomputes the foreground mask from a QImage of any format */
+      void update(const QImage &image);
+
+      /** Forgets the mask and the learned mean */
+      void reset();
+
+      bool isForeground(int x, int y) const;
+      int foregroundCount() const;
+
+      /** Picks a random foreground pixel of the last frame. Returns false if
+          there is none, in which case the caller should sample uniformly */
+      bool randomForegroundPixel(int *x, int *y) const;
+
+    private:
+      bool classify(int index, int blue, int green, int red);
+
+      Mode m_mode;
+      QColor m_color;
+      int m_tolerance;
+      qreal m_learnRate;
+
+      int m_width;
+      int m_height;
+      bool m_meanInitialized;
+      QVector<float> m_mean; // 3 floats (b, g, r) per pixel
+      QVector<uchar> m_mask;
+      QVector<int> m_foreground; // y*width + x of every foreground pixel
+  };
+
+}
+
+#endif //GNG_BACKGROUNDMODEL_H
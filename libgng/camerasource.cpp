@@ -1,56 +1,161 @@
 #include "camerasource.h"
+#include "backgroundmodel.h"
+#include "motionmap.h"
+#include "clock.h"
+
+#include <libaibo/trace.h>
 
 #include <QDebug>
-#include <QColor>
+#include <QThread>
 
-using namespace GNG;
+namespace GNG {
+
+  /** Runs CameraSource::processNextFrame() until stopped */
+  class CameraCapture : public QThread {
+    public:
+      CameraCapture(CameraSource *source) : m_source(source)
+      {
+        setObjectName("camera capture");
+      }
+
+      void stopCapture()
+      {
+        m_stopped = 1;
+        wait();
+      }
+
+    protected:
+      virtual void run()
+      {
+        while (!m_stopped) {
+          if (!m_source->processNextFrame()) {
+            msleep(10); // Don't spin on a device that has nothing for us
+          }
+        }
+      }
+
+    private:
+      friend class CameraSource;
+      CameraSource *m_source;
+      QAtomicInt m_stopped;
+  };
+
+}
 
-static QImage IplImageToQImage(const IplImage  *iplImage, uchar **data , bool mirroRimage = true );
+using namespace GNG;
 
 CameraSource::CameraSource()
 {
-  m_nextFrameTimer.setInterval(40);
-  connect(&m_nextFrameTimer, SIGNAL(timeout()), SLOT(processNextFrame()));
   m_frame = 0;
-  m_imageData = 0;
+  m_hsl = 0;
+  m_imageStale = false;
+  m_frameAge = 0;
+  m_averageFrameAge = 0;
+  m_background = 0;
+  m_motion = 0;
+  m_changeCount = 0;
+  m_capture = new CameraCapture(this);
   m_device = cvCreateCameraCapture(-1);
   if (!m_device){
     qDebug() << "Camera not found";
     return;
   }
-  //m_image = QImage(QSize(width(), height()), QImage::Format_RGB32);
+  // Have a frame (and a size) available right away
   processNextFrame();
+  updateFrame();
 }
 CameraSource::~CameraSource()
 {
-//   delete m_device; //TODO: Memleaks
-//   delete m_frame;
+  stop();
+  delete m_capture;
+  for (int i=0; i<3; i++) {
+    if (m_frames.slot(i).image) {
+      cvReleaseImage(&m_frames.slot(i).image);
+    }
+  }
+  if (m_device) {
+    cvReleaseCapture(&m_device);
+  }
 }
 
 void CameraSource::start()
 {
-  m_nextFrameTimer.start();
+  if (!m_device || m_capture->isRunning()) {
+    return;
+  }
+  m_capture->m_stopped = 0;
+  m_capture->start();
 }
 void CameraSource::stop()
 {
-  m_nextFrameTimer.stop();
+  if (m_capture->isRunning()) {
+    m_capture->stopCapture();
+  }
 }
 
 
-void CameraSource::processNextFrame()
+// Capture thread. The captured frame belongs to OpenCV and is overwritten
+// by the next grab, so it is copied once into the back slot of the triple
+// buffer and converted to HSL there. Everything else reads that slot.
+bool CameraSource::processNextFrame()
 {
-  cvGrabFrame(m_device);
-  m_frame = cvRetrieveFrame(m_device);
-  convertFrameToImage();
+  TRACE_SCOPE("CameraSource::processNextFrame");
+  if (!cvGrabFrame(m_device)) {
+    return false;
+  }
+  qint64 captureTime = monotonicTime();
+  IplImage *captured = cvRetrieveFrame(m_device);
+  if (!captured) {
+    return false;
+  }
+  if (captured->depth != IPL_DEPTH_8U || captured->nChannels != 3) {
+    qDebug("CameraSource: frame format is not supported : depth=%d and %d channels", captured->depth, captured->nChannels);
+    return false;
+  }
+  
+  CameraFrame &frame = m_frames.back();
+  if (!frame.image || frame.image->width != captured->width || frame.image->height != captured->height) {
+    if (frame.image) {
+      cvReleaseImage(&frame.image);
+    }
+    frame.image = cvCreateImage(cvGetSize(captured), IPL_DEPTH_8U, 3);
+  }
+  cvCopy(captured, frame.image);
+  frame.hsl.convertBgr((const uchar*)frame.image->imageData, frame.image->width, frame.image->height,
+                       frame.image->widthStep, frame.image->nChannels);
+  frame.captureTime = captureTime;
+  frame.sequence = m_capturedFrames.fetchAndAddRelaxed(1) + 1;
+  
+  if (m_frames.publish()) {
+    m_droppedFrames.fetchAndAddRelaxed(1);
+  }
   emit imageUpdated();
+  return true;
 }
 
-void CameraSource::convertFrameToImage()
+// Sampling thread. Switches to the newest published frame, if any.
+bool CameraSource::updateFrame()
 {
-  if (m_imageData) {
-    delete m_imageData;
+  if (!m_frames.update()) {
+    return false;
+  }
+  
+  const CameraFrame &frame = m_frames.front();
+  m_frame = frame.image;
+  m_hsl = &frame.hsl;
+  m_imageStale = true;
+  
+  m_frameAge = (monotonicTime() - frame.captureTime) / 1000000.0;
+  m_averageFrameAge = 0.9*m_averageFrameAge + 0.1*m_frameAge;
+  
+  if (m_background) {
+    m_background->update((const uchar*)m_frame->imageData, m_frame->width, m_frame->height,
+                         m_frame->widthStep, m_frame->nChannels);
   }
-  m_image = IplImageToQImage(m_frame, &m_imageData, false);
+  if (!m_motion || m_motion->update(*m_hsl)) {
+    m_changeCount++;
+  }
+  return true;
 }
 
 int CameraSource::dimension()
@@ -58,195 +163,85 @@ int CameraSource::dimension()
   return 5;
 }
 
-QImage CameraSource::image() const
+QImage CameraSource::image()
 {
+  updateFrame();
+  if (m_imageStale && m_frame) {
+    // Wrap the BGR frame without copying, then swap into RGB for display.
+    // This is the only copy of the frame and only happens when a viewer asks.
+    QImage bgr((const uchar*)m_frame->imageData, m_frame->width, m_frame->height,
+               m_frame->widthStep, QImage::Format_RGB888);
+    m_image = bgr.rgbSwapped();
+    m_imageStale = false;
+  }
   return m_image;
 }
 
+void CameraSource::setBackgroundModel(BackgroundModel* model)
+{
+  m_background = model;
+}
+
+void CameraSource::setMotionMap(MotionMap* motion)
+{
+  m_motion = motion;
+}
+
+int CameraSource::changeCount()
+{
+  updateFrame();
+  return m_changeCount;
+}
+
+int CameraSource::capturedFrames() const
+{
+  return m_capturedFrames;
+}
+int CameraSource::droppedFrames() const
+{
+  return m_droppedFrames;
+}
+qreal CameraSource::frameAge() const
+{
+  return m_frameAge;
+}
+qreal CameraSource::averageFrameAge() const
+{
+  return m_averageFrameAge;
+}
+
 int CameraSource::width()
 {
-  return m_frame->width; //TODO: Why not working?
-  //return cvGetCaptureProperty(m_device, CV_CAP_PROP_FRAME_WIDTH);
+  return m_frame ? m_frame->width : 0;
 }
 
 int CameraSource::height()
 {
-  return m_frame->height;
-  //return cvGetCaptureProperty(m_device, CV_CAP_PROP_FRAME_HEIGHT);
+  return m_frame ? m_frame->height : 0;
 }
 
 Point CameraSource::generatePoint()
 {
-  int x = qrand() % width();
-  int y = qrand() % height();
+  updateFrame();
+  
+  int x, y;
+  bool picked = (m_motion && m_motion->pickChangedPixel(&x, &y)
+                 && (!m_background || m_background->isForeground(x, y)))
+             || (m_background && m_background->randomForegroundPixel(&x, &y));
+  if (!picked) {
+    x = qrand() % width();
+    y = qrand() % height();
+  }
 
   return pointFromXY(x, y);
 }
 
 Point CameraSource::pointFromXY(int x, int y)
 {
-  CvScalar s;
-  s=cvGet2D(m_frame, y, x); // get the (row,col) pixel value 
-  
-  // 2 1 0 because data is BGR not RGB
-  QColor rgb = QColor::fromRgb(s.val[2], s.val[1], s.val[0]);
-  QColor hsl = rgb.toHsl();
-  
   Point p(dimension());
   p[0] = normalize(x, width());
   p[1] = normalize(y, height());
 
-  hsl.getHslF(&p[2], &p[3], &p[4]);
+  m_hsl->hsl(x, y, &p[2], &p[3], &p[4]);
   return p;
 }
-
-
-// Converting a IPL Image to a QImage
-// Code from http://www.qtcentre.org/threads/11655-OpenCV-integration?p=72374#post72374
-// 
-
-#include "cv.h"
-#include "highgui.h"
-#include <stdio.h>
-#include <ctype.h>
-
-static QImage IplImageToQImage(const IplImage  *iplImage, uchar **data , bool mirroRimage )
-{
-  uchar *qImageBuffer = NULL;
-  int    width        = iplImage->width;
-
-  /*
-   * Note here that OpenCV image is stored so that each lined is 32-bits aligned thus
-   * explaining the necessity to "skip" the few last bytes of each line of OpenCV image buffer.
-   */
-  int widthStep = iplImage->widthStep;
-  int height    = iplImage->height;
-
-  switch (iplImage->depth)
-  {
-    case IPL_DEPTH_8U:
-      if (iplImage->nChannels == 1)
-      {
-        /* OpenCV image is stored with one byte grey pixel. We convert it to an 8 bit depth QImage. */
-        qImageBuffer = (uchar *)malloc(width * height * sizeof(uchar));
-        uchar *QImagePtr = qImageBuffer;
-        const uchar *iplImagePtr = (const uchar *)iplImage->imageData;
-        for (int y = 0; y < height; ++y)
-        {
-          // Copy line by line
-          memcpy(QImagePtr, iplImagePtr, width);
-          QImagePtr += width;
-          iplImagePtr += widthStep;
-        }
-      }
-      else if (iplImage->nChannels == 3)
-      {
-        /* OpenCV image is stored with 3 byte color pixels (3 channels). We convert it to a 32 bit depth QImage. */
-        qImageBuffer = (uchar *)malloc(width * height * 4 * sizeof(uchar));
-        uchar *QImagePtr = qImageBuffer;
-        const uchar *iplImagePtr = (const uchar *)iplImage->imageData;
-
-        for (int y = 0; y < height; ++y)
-        {
-          for (int x = 0; x < width; ++x)
-          {
-            // We cannot help but copy manually.
-            QImagePtr[0] = iplImagePtr[0];
-            QImagePtr[1] = iplImagePtr[1];
-            QImagePtr[2] = iplImagePtr[2];
-            QImagePtr[3] = 0;
-
-            QImagePtr += 4;
-            iplImagePtr += 3;
-          }
-          iplImagePtr += widthStep - 3 * width;
-        }
-      }
-      else
-        qDebug("IplImageToQImage: image format is not supported : depth=8U and %d channels\n", iplImage->nChannels);
-
-      break;
-
-    case IPL_DEPTH_16U:
-      if (iplImage->nChannels == 1)
-      {
-        /* OpenCV image is stored with 2 bytes grey pixel. We convert it to an 8 bit depth QImage. */
-        qImageBuffer = (uchar *)malloc(width * height * sizeof(uchar));
-        uchar *QImagePtr = qImageBuffer;
-        const uint16_t *iplImagePtr = (const uint16_t *)iplImage->imageData;
-
-        for (int y = 0; y < height; ++y)
-        {
-          for (int x = 0; x < width; ++x)
-            *QImagePtr++ = ((*iplImagePtr++) >> 8); // We take only the highest part of the 16 bit value. It is similar to dividing by 256.
-          iplImagePtr += widthStep / sizeof(uint16_t) - width;
-        }
-      }
-      else
-        qDebug("IplImageToQImage: image format is not supported : depth=16U and %d channels\n", iplImage->nChannels);
-
-      break;
-
-    case IPL_DEPTH_32F:
-      if (iplImage->nChannels == 1)
-      {
-        /* OpenCV image is stored with float (4 bytes) grey pixel. We convert it to an 8 bit depth QImage. */
-        qImageBuffer = (uchar *)malloc(width * height * sizeof(uchar));
-        uchar *QImagePtr = qImageBuffer;
-        const float *iplImagePtr = (const float *)iplImage->imageData;
-
-        for (int y = 0; y < height; ++y)
-        {
-          for (int x = 0; x < width; ++x)
-            *QImagePtr++ = (uchar)(255 * ((*iplImagePtr++)));
-          iplImagePtr += widthStep / sizeof(float) - width;
-        }
-      }
-      else
-        qDebug("IplImageToQImage: image format is not supported : depth=32F and %d channels\n", iplImage->nChannels);
-
-      break;
-
-    case IPL_DEPTH_64F:
-      if (iplImage->nChannels == 1)
-      {
-        /* OpenCV image is stored with double (8 bytes) grey pixel. We convert it to an 8 bit depth QImage. */
-        qImageBuffer = (uchar *) malloc(width * height * sizeof(uchar));
-        uchar *QImagePtr = qImageBuffer;
-        const double *iplImagePtr = (const double *) iplImage->imageData;
-
-        for (int y = 0; y < height; ++y)
-        {
-          for (int x = 0; x < width; ++x)
-            *QImagePtr++ = (uchar)(255 * ((*iplImagePtr++)));
-          iplImagePtr += widthStep / sizeof(double) - width;
-        }
-      }
-      else
-        qDebug("IplImageToQImage: image format is not supported : depth=64F and %d channels\n", iplImage->nChannels);
-
-      break;
-
-    default:
-      qDebug("IplImageToQImage: image format is not supported : depth=%d and %d channels\n", iplImage->depth, iplImage->nChannels);
-  }
-
-  QImage *qImage;
-  if (iplImage->nChannels == 1)
-  {
-    QVector<QRgb> colorTable;
-    for (int i = 0; i < 256; i++)
-      colorTable.push_back(qRgb(i, i, i));
-
-    qImage = new QImage(qImageBuffer, width, height, QImage::Format_Indexed8);
-    qImage->setColorTable(colorTable);
-  }
-  else
-    qImage = new QImage(qImageBuffer, width, height, QImage::Format_RGB32);
-  
-  QImage gd0 = qImage->mirrored(false,mirroRimage);
-  *data = qImageBuffer;
-  
-  return gd0;
-}
-
@@ -3,15 +3,35 @@
 
 #include <QObject>
 #include <QImage>
-#include <QTimer>
+#include <QAtomicInt>
 
 #include "pointsource.h"
+#include "triplebuffer.h"
+#include "hslimage.h"
 
 #include <cv.h>
 #include <highgui.h>
 
 namespace GNG {
+  class BackgroundModel;
+  class MotionMap;
+  class CameraCapture;
   
+  /** A captured frame, its HSL planes and the time it was captured */
+  struct CameraFrame {
+    CameraFrame() : image(0), captureTime(0), sequence(0) {}
+    IplImage *image;
+    HslImage hsl;
+    qint64 captureTime; /**< monotonicTime() right after the grab */
+    int sequence;
+  };
+  
+  /**
+      Samples points from a camera. Frames are captured on their own
+      thread as fast as the device delivers them and handed to the
+      sampling thread through a triple buffer, so the newest frame always
+      wins and neither side waits for the other.
+  */
   class CameraSource : public QObject, public PointSource {
     Q_OBJECT
     public:
@@ -20,31 +40,59 @@ namespace GNG {
       
       virtual int dimension();
       virtual Point generatePoint();
+      virtual int changeCount();
       
       int width();
       int height();
       
+      /** Start/stop the capture thread */
       void start();
       void stop();
       
-      QImage image() const;
-    
-    public slots:
-      void processNextFrame();
+      /** The newest frame for display. Only converted when asked for */
+      QImage image();
+      
+      /** Only sample pixels that the model classifies as foreground. Pass 0 to sample every pixel */
+      void setBackgroundModel(BackgroundModel *model);
+      /** Draw part of the samples from the regions that changed since the last frame. Pass 0 to disable */
+      void setMotionMap(MotionMap *motion);
+      
+      int capturedFrames() const; /**< Frames captured since construction */
+      int droppedFrames() const; /**< Frames replaced by a newer one before they were sampled */
+      qreal frameAge() const; /**< Milliseconds from capture of the current frame to its first use */
+      qreal averageFrameAge() const; /**< Moving average of frameAge() */
+      
+      /** Grabs and publishes one frame. Blocks until the device delivers.
+          Runs on the capture thread once start() has been called */
+      bool processNextFrame();
       
     signals:
+      /** Emitted from the capture thread for every new frame */
       void imageUpdated();
 
     private:
+      bool updateFrame();
       Point pointFromXY(int x, int y);
-      void convertFrameToImage();
-      QImage m_image;
-      uchar* m_imageData;
-      QTimer m_nextFrameTimer;
+      
+      // Capture thread side
       CvCapture *m_device;
+      CameraCapture *m_capture;
+      TripleBuffer<CameraFrame> m_frames;
+      QAtomicInt m_capturedFrames;
+      QAtomicInt m_droppedFrames;
+      
+      // Sampling thread side
       IplImage *m_frame;
+      const HslImage *m_hsl;
+      QImage m_image;
+      bool m_imageStale;
+      qreal m_frameAge;
+      qreal m_averageFrameAge;
+      BackgroundModel *m_background;
+      MotionMap *m_motion;
+      int m_changeCount;
   };
 
 }
 
-#endif //GNG_CAMERASOURCE_H
\ No newline at end of file
+#endif //GNG_CAMERASOURCE_H
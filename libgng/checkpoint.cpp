@@ -0,0 +1,275 @@
+#include "checkpoint.h"
+#include "gng.h"
+#include "node.h"
+#include "edge.h"
+
+#include <QFile>
+#include <QHash>
+#include <QDebug>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+using namespace GNG;
+
+// Layout, in host byte order:
+//
+//   Header
+//   double locations[nodeCount][dimension]
+//   double errors[nodeCount]
+//   EdgeRecord edges[edgeCount]
+//
+// The header is a multiple of 8 bytes long so the arrays stay aligned
+// when the file is mapped.
+
+namespace {
+
+  const char Magic[8] = { 'G', 'N', 'G', 'C', 'K', 'P', 'T', 0 };
+  const quint32 ByteOrderMark = 0x01020304;
+  const quint32 Version = 1;
+
+  struct Header {
+    char magic[8];
+    quint32 byteOrder;
+    quint32 version;
+    quint32 headerSize;
+    qint32 dimension;
+    qint32 nodeCount;
+    qint32 edgeCount;
+
+    // Network
+    qint32 currentStep;
+    qint32 stepsSinceLastInsert;
+
+    // Parameters
+    qint32 delay;
+    qint32 updateInterval;
+    qint32 maxEdgeAge;
+    qint32 minStepsBetweenInsertions;
+    qint32 staticStepLimit;
+    qint32 reserved;
+    double minimum;
+    double maximum;
+    double winnerLearnRate;
+    double neighborLearnRate;
+    double reduceErrorMultiplier;
+    double insertErrorMultiplier;
+    double targetError;
+    double maxEdgeColorDiff;
+  };
+
+  struct EdgeRecord {
+    qint32 from; // node indices
+    qint32 to;
+    qint32 age;
+    qint32 totalAge;
+    qint32 history; // GrowingNeuralGas::edgeHistoryAge()
+  };
+
+  // Index of every node and one entry per undirected edge
+  void collectEdges(const QList<Node*> &nodes, QList<Edge*> *edges, QHash<Node*, int> *indices)
+  {
+    for (int i=0; i<nodes.size(); i++) {
+      indices->insert(nodes[i], i);
+    }
+    foreach (Node *node, nodes) {
+      foreach (Edge *edge, node->edges()) {
+        if (indices->value(edge->from()) < indices->value(edge->to())) {
+          edges->append(edge);
+        }
+      }
+    }
+  }
+
+}
+
+bool Checkpoint::save(const GrowingNeuralGas& gng, const QString& fileName)
+{
+  QList<Edge*> edges;
+  QHash<Node*, int> indices;
+  collectEdges(gng.m_nodes, &edges, &indices);
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, Magic, sizeof(Magic));
+  header.byteOrder = ByteOrderMark;
+  header.version = Version;
+  header.headerSize = sizeof(Header);
+  header.dimension = gng.m_dimension;
+  header.nodeCount = gng.m_nodes.size();
+  header.edgeCount = edges.size();
+  header.currentStep = gng.m_currentStep;
+  header.stepsSinceLastInsert = gng.m_stepsSinceLastInsert;
+  header.delay = gng.m_delay;
+  header.updateInterval = gng.m_updateInterval;
+  header.maxEdgeAge = gng.m_maxEdgeAge;
+  header.minStepsBetweenInsertions = gng.m_minStepsBetweenInsertions;
+  header.staticStepLimit = gng.m_staticStepLimit;
+  header.minimum = gng.m_min;
+  header.maximum = gng.m_max;
+  header.winnerLearnRate = gng.m_winnerLearnRate;
+  header.neighborLearnRate = gng.m_neighborLearnRate;
+  header.reduceErrorMultiplier = gng.m_reduceErrorMultiplier;
+  header.insertErrorMultiplier = gng.m_insertErrorMultiplier;
+  header.targetError = gng.m_targetError;
+  header.maxEdgeColorDiff = gng.m_maxEdgeColorDiff;
+
+  QByteArray data;
+  data.reserve(sizeof(Header) + header.nodeCount*(header.dimension + 1)*sizeof(double)
+               + header.edgeCount*sizeof(EdgeRecord));
+  data.append((const char*)&header, sizeof(header));
+
+  foreach (Node *node, gng.m_nodes) {
+    Point location = node->location();
+    for (int i=0; i<header.dimension; i++) {
+      double value = location.at(i);
+      data.append((const char*)&value, sizeof(value));
+    }
+  }
+  foreach (Node *node, gng.m_nodes) {
+    double error = node->error();
+    data.append((const char*)&error, sizeof(error));
+  }
+  foreach (Edge *edge, edges) {
+    EdgeRecord record;
+    record.from = indices.value(edge->from());
+    record.to = indices.value(edge->to());
+    record.age = edge->age();
+    record.totalAge = edge->totalAge();
+    record.history = gng.edgeHistoryAge(edge);
+    data.append((const char*)&record, sizeof(record));
+  }
+
+  // Write next to the target and rename over it, which replaces it atomically
+  QString temporaryName = fileName + ".tmp";
+  QFile file(temporaryName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning() << "Could not write checkpoint" << temporaryName << ":" << file.errorString();
+    return false;
+  }
+  bool written = file.write(data) == data.size() && file.flush() && fsync(file.handle()) == 0;
+  file.close();
+  if (!written) {
+    qWarning() << "Could not write checkpoint" << temporaryName << ":" << file.errorString();
+    QFile::remove(temporaryName);
+    return false;
+  }
+  if (rename(QFile::encodeName(temporaryName).constData(), QFile::encodeName(fileName).constData()) != 0) {
+    qWarning() << "Could not replace checkpoint" << fileName;
+    QFile::remove(temporaryName);
+    return false;
+  }
+  return true;
+}
+
+bool Checkpoint::load(GrowingNeuralGas* gng, const QString& fileName, Contents contents)
+{
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Could not read checkpoint" << fileName << ":" << file.errorString();
+    return false;
+  }
+  qint64 size = file.size();
+  if (size < (qint64)sizeof(Header)) {
+    qWarning() << fileName << "is not a GNG checkpoint";
+    return false;
+  }
+  const uchar *data = file.map(0, size);
+  if (!data) {
+    qWarning() << "Could not map checkpoint" << fileName << ":" << file.errorString();
+    return false;
+  }
+
+  const Header *header = (const Header*)data;
+  if (memcmp(header->magic, Magic, sizeof(Magic)) != 0) {
+    qWarning() << fileName << "is not a GNG checkpoint";
+    return false;
+  }
+  if (header->byteOrder != ByteOrderMark || header->version != Version || header->headerSize != sizeof(Header)) {
+    qWarning() << "Checkpoint" << fileName << "is version" << header->version
+               << "or from a machine with a different byte order";
+    return false;
+  }
+  if (header->dimension != gng->m_dimension) {
+    qWarning() << "Checkpoint" << fileName << "has" << header->dimension
+               << "dimensions, the GNG has" << gng->m_dimension;
+    return false;
+  }
+
+  // Sized from the counts before any pointer is formed from them, a
+  // corrupt header must not point outside the mapping
+  int nodeCount = header->nodeCount;
+  int edgeCount = header->edgeCount;
+  if (nodeCount < 2 || edgeCount < 0
+      || qint64(sizeof(Header)) + qint64(nodeCount)*(header->dimension + 1)*qint64(sizeof(double))
+         + qint64(edgeCount)*qint64(sizeof(EdgeRecord)) > size) {
+    qWarning() << "Checkpoint" << fileName << "is truncated";
+    return false;
+  }
+  const double *locations = (const double*)(data + sizeof(Header));
+  const double *errors = locations + (qint64)nodeCount*header->dimension;
+  const EdgeRecord *edges = (const EdgeRecord*)(errors + nodeCount);
+  for (int i=0; i<edgeCount; i++) {
+    if (edges[i].from < 0 || edges[i].from >= nodeCount || edges[i].to < 0
+        || edges[i].to >= nodeCount || edges[i].from == edges[i].to) {
+      qWarning() << "Checkpoint" << fileName << "has an invalid edge";
+      return false;
+    }
+  }
+
+  if (contents & Parameters) {
+    gng->m_delay = header->delay;
+    gng->m_updateInterval = header->updateInterval;
+    gng->m_maxEdgeAge = header->maxEdgeAge;
+    gng->m_minStepsBetweenInsertions = header->minStepsBetweenInsertions;
+    gng->m_staticStepLimit = header->staticStepLimit;
+    gng->m_winnerLearnRate = header->winnerLearnRate;
+    gng->m_neighborLearnRate = header->neighborLearnRate;
+    gng->m_reduceErrorMultiplier = header->reduceErrorMultiplier;
+    gng->m_insertErrorMultiplier = header->insertErrorMultiplier;
+    gng->m_targetError = header->targetError;
+    gng->m_maxEdgeColorDiff = header->maxEdgeColorDiff;
+  }
+
+  if (contents & Network) {
+    gng->clearNetwork();
+
+    QVector<Node*> nodes(nodeCount);
+    for (int i=0; i<nodeCount; i++) {
+      Point location(header->dimension);
+      const double *saved = locations + (qint64)i*header->dimension;
+      for (int j=0; j<header->dimension; j++) {
+        location[j] = saved[j];
+      }
+      nodes[i] = new Node(location, gng->m_dimension, gng->m_min, gng->m_max);
+      nodes[i]->setError(errors[i]);
+      gng->m_nodes.append(nodes[i]);
+    }
+
+    for (int i=0; i<edgeCount; i++) {
+      Node *from = nodes[edges[i].from];
+      Node *to = nodes[edges[i].to];
+      if (from->hasEdgeTo(to)) {
+        continue;
+      }
+      gng->connectNodes(from, to);
+      Edge *forward = from->getEdgeTo(to);
+      Edge *backward = to->getEdgeTo(from);
+      forward->setAge(edges[i].age);
+      backward->setAge(edges[i].age);
+      forward->setTotalAge(edges[i].totalAge);
+      backward->setTotalAge(edges[i].totalAge);
+      if (edges[i].history > 0) {
+        NodePair pair = from < to ? NodePair(from, to) : NodePair(to, from);
+        gng->m_edgeHistory.insert(pair, edges[i].history);
+      }
+    }
+
+    gng->m_currentStep = header->currentStep;
+    gng->m_stepsSinceLastInsert = header->stepsSinceLastInsert;
+  }
+
+  file.unmap((uchar*)data);
+  return true;
+}
@@ -0,0 +1,38 @@
+#ifndef GNG_CHECKPOINT_H
+#define GNG_CHECKPOINT_H
+
+#include <QString>
+
+namespace GNG {
+
+  class GrowingNeuralGas;
+
+  /**
+      Saves and restores a trained GrowingNeuralGas: node locations and
+      errors, the undirected edges with their ages, total ages and history,
+      the step counter and the parameters.
+
+      The file is a fixed header followed by flat arrays, so loading maps
+      the file and walks the arrays without parsing. Saving writes a
+      temporary file and renames it over the old one, so a checkpoint is
+      never left half written.
+  */
+  class Checkpoint {
+
+    public:
+      enum Contents {
+        Network = 1,    /**< Nodes, edges and step counter */
+        Parameters = 2, /**< Learn rates, ages, errors and intervals */
+        Everything = Network | Parameters
+      };
+
+      /** Writes the GNG to fileName. Returns false, with a warning, on failure */
+      static bool save(const GrowingNeuralGas &gng, const QString &fileName);
+      /** Replaces the network and/or parameters of the GNG with the saved ones.
+          The GNG is left untouched if the file can't be used */
+      static bool load(GrowingNeuralGas *gng, const QString &fileName, Contents contents = Everything);
+  };
+
+}
+
+#endif //GNG_CHECKPOINT_H
@@ -0,0 +1,21 @@
+#ifndef GNG_CLOCK_H
+#define GNG_CLOCK_H
+
+#include <QtGlobal>
+
+#include <time.h>
+
+namespace GNG {
+
+  /** Nanoseconds on a monotonic clock. Comparable between threads, so it
+      is used to timestamp frames and measure latencies */
+  inline qint64 monotonicTime()
+  {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return qint64(now.tv_sec)*1000000000 + now.tv_nsec;
+  }
+
+}
+
+#endif //GNG_CLOCK_H
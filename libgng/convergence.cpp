@@ -0,0 +1,108 @@
+#include "convergence.h"
+#include "gng.h"
+#include "node.h"
+#include "pointsource.h"
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+using namespace GNG;
+
+namespace {
+
+  /** A share of the held-out points, measured on one core */
+  struct Chunk {
+    const QVector<Point> *points;
+    const QVector<Point> *nodes;
+    int begin;
+    int end;
+  };
+
+  qreal chunkError(const Chunk &chunk)
+  {
+    qreal sum = 0;
+    for (int i=chunk.begin; i<chunk.end; i++) {
+      const Point &point = chunk.points->at(i);
+      qreal nearest = -1;
+      foreach (const Point &node, *chunk.nodes) {
+        qreal distance = node.distanceTo(point);
+        if (nearest < 0 || distance < nearest) {
+          nearest = distance;
+        }
+      }
+      sum += nearest*nearest;
+    }
+    return sum;
+  }
+
+  void addError(qreal &total, const qreal &chunk)
+  {
+    total += chunk;
+  }
+
+}
+
+ConvergenceMonitor::ConvergenceMonitor(PointSource* source, int heldOutPoints)
+{
+  m_heldOut.reserve(heldOutPoints);
+  for (int i=0; i<heldOutPoints; i++) {
+    m_heldOut.append(source->generatePoint());
+  }
+}
+
+qreal ConvergenceMonitor::quantizationError(const GrowingNeuralGas& gng, bool parallel) const
+{
+  if (m_heldOut.isEmpty() || gng.nodes().isEmpty()) {
+    return 0;
+  }
+
+  // Workers only read copies, the GNG can go on afterwards
+  QVector<Point> nodes;
+  foreach (Node *node, gng.nodes()) {
+    nodes.append(node->location());
+  }
+
+  // A few chunks per core, so a slow core doesn't hold up the rest
+  if (!parallel) {
+    Chunk all = { &m_heldOut, &nodes, 0, m_heldOut.size() };
+    return chunkError(all) / m_heldOut.size();
+  }
+  int chunkCount = qMin(m_heldOut.size(), 4*qMax(QThread::idealThreadCount(), 1));
+  QList<Chunk> chunks;
+  for (int i=0; i<chunkCount; i++) {
+    Chunk chunk;
+    chunk.points = &m_heldOut;
+    chunk.nodes = &nodes;
+    chunk.begin = qint64(i)*m_heldOut.size()/chunkCount;
+    chunk.end = qint64(i+1)*m_heldOut.size()/chunkCount;
+    chunks.append(chunk);
+  }
+  qreal total = QtConcurrent::blockingMappedReduced<qreal>(chunks, chunkError, addError);
+  return total / m_heldOut.size();
+}
+
+const ConvergenceMonitor::Sample& ConvergenceMonitor::record(const GrowingNeuralGas& gng, qreal trainingSeconds)
+{
+  Sample sample;
+  sample.step = gng.currentStep();
+  sample.seconds = trainingSeconds;
+  sample.nodes = gng.nodes().size();
+  sample.error = quantizationError(gng);
+  m_samples.append(sample);
+  return m_samples.last();
+}
+
+QList<ConvergenceMonitor::Sample> ConvergenceMonitor::samples() const
+{
+  return m_samples;
+}
+
+const ConvergenceMonitor::Sample* ConvergenceMonitor::reached(qreal error) const
+{
+  for (int i=0; i<m_samples.size(); i++) {
+    if (m_samples[i].error <= error) {
+      return &m_samples[i];
+    }
+  }
+  return 0;
+}
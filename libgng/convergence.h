@@ -0,0 +1,53 @@
+#ifndef GNG_CONVERGENCE_H
+#define GNG_CONVERGENCE_H
+
+#include <QVector>
+#include <QList>
+
+#include "point.h"
+
+namespace GNG {
+  class GrowingNeuralGas;
+  class PointSource;
+
+  /**
+      Follows how well a GNG has learned its input. A fixed held-out set
+      of points is drawn from a source once, and record() measures the
+      mean quantization error of the network on it: the squared distance
+      from each held-out point to its nearest node, by the distance the
+      GNG trains with, averaged. The points are split between all cores.
+
+      Draw the held-out set from a source of its own, or before seeding
+      the one the GNG trains on, so it doesn't change the training run.
+  */
+  class ConvergenceMonitor {
+
+    public:
+      struct Sample {
+        int step;
+        qreal seconds; /**< Of training, not counting the measurements */
+        int nodes;
+        qreal error;
+      };
+
+      ConvergenceMonitor(PointSource *source, int heldOutPoints);
+
+      /** Mean quantization error of the network on the held-out points.
+          Measured on the calling thread alone unless parallel */
+      qreal quantizationError(const GrowingNeuralGas &gng, bool parallel = true) const;
+
+      /** Measures the network and keeps the result */
+      const Sample& record(const GrowingNeuralGas &gng, qreal trainingSeconds);
+      QList<Sample> samples() const;
+
+      /** The first sample at or below the error, 0 if none is */
+      const Sample* reached(qreal error) const;
+
+    private:
+      QVector<Point> m_heldOut;
+      QList<Sample> m_samples;
+  };
+
+}
+
+#endif // GNG_CONVERGENCE_H
@@ -1,14 +1,16 @@
 
 #include "edge.h"
 
+#include <QAtomicInt>
+
 using namespace GNG;
 
-static int currentId = 0;
+// Shared by the GNGs of all threads
+static QAtomicInt currentId(0);
 
 Edge::Edge(GNG::Node* from, GNG::Node* to)
-  : m_id(currentId)
+  : m_id(currentId.fetchAndAddRelaxed(1))
 {
-  currentId++;
   m_from = from;
   m_to = to;
   m_age = 0;
@@ -63,6 +65,10 @@ void Edge::incrementTotalAge()
 {
   m_totalAge++;
 }
+void Edge::setTotalAge(int age)
+{
+  m_totalAge = age;
+}
 
 int Edge::lastUpdated()
 {
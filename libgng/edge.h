@@ -30,6 +30,7 @@ namespace GNG {
       
       int totalAge() const;
       void incrementTotalAge();
+      void setTotalAge(int age);
       
       // timestamp is in milliseconds since the gng was started
       int lastUpdated();
@@ -0,0 +1,228 @@
+#include "eventlog.h"
+#include "clock.h"
+
+#include <QStringList>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace GNG;
+
+const int EventLog::SlotCount;
+
+static const char *categoryNames[] = { "training", "topology", "source" };
+static const char *levelNames[] = { "debug", "info", "warning", "off" };
+
+// Background thread checks back this often when the ring is empty
+static const int IdleSleep = 5; // milliseconds
+
+EventLog* EventLog::instance()
+{
+  static EventLog log;
+  return &log;
+}
+
+EventLog::EventLog()
+  : m_dequeuePosition(0),
+    m_started(monotonicTime())
+{
+  for (int i=0; i<SlotCount; i++) {
+    m_slots[i].sequence = i;
+  }
+  for (int i=0; i<CategoryCount; i++) {
+    m_levels[i] = Info;
+    m_rateLimits[i] = 20;
+  }
+
+  configure(QString::fromLocal8Bit(getenv("GNG_LOG")));
+  if (getenv("GNG_LOG_RATE")) {
+    int rate = atoi(getenv("GNG_LOG_RATE"));
+    for (int i=0; i<CategoryCount; i++) {
+      m_rateLimits[i] = qMax(rate, 0);
+    }
+  }
+
+  start(QThread::LowPriority);
+}
+
+EventLog::~EventLog()
+{
+  m_stopping = 1;
+  wait();
+}
+
+void EventLog::configure(const QString& spec)
+{
+  foreach (QString setting, spec.split(',', QString::SkipEmptyParts)) {
+    QStringList parts = setting.trimmed().split('=');
+    int category = -1;
+    int level = -1;
+    for (int i=0; i<CategoryCount && parts.size() == 2; i++) {
+      if (parts[0] == categoryNames[i]) {
+        category = i;
+      }
+    }
+    for (int i=0; i<=Off && parts.size() == 2; i++) {
+      if (parts[1] == levelNames[i]) {
+        level = i;
+      }
+    }
+    if (category < 0 || level < 0) {
+      fprintf(stderr, "Ignoring log setting %s\n", setting.toLocal8Bit().constData());
+      continue;
+    }
+    setLevel(Category(category), Level(level));
+  }
+}
+
+void EventLog::setLevel(Category category, Level level)
+{
+  m_levels[category] = level;
+}
+
+EventLog::Level EventLog::level(Category category) const
+{
+  return Level((int)m_levels[category]);
+}
+
+void EventLog::setRateLimit(Category category, int perSecond)
+{
+  m_rateLimits[category] = qMax(perSecond, 0);
+}
+
+// At most the rate limit of events per wall clock second
+bool EventLog::allowed(Category category)
+{
+  int limit = m_rateLimits[category];
+  if (limit == 0) {
+    return true;
+  }
+  int second = (monotonicTime() - m_started) / 1000000000;
+  int window = m_rateWindows[category];
+  if (window != second && m_rateWindows[category].testAndSetRelaxed(window, second)) {
+    m_rateCounts[category] = 0;
+  }
+  return m_rateCounts[category].fetchAndAddRelaxed(1) < limit;
+}
+
+// A bounded multi-producer queue: each slot's sequence tells whether it
+// is free for the producer at that position or holds an event for the
+// consumer, so neither side ever takes a lock
+void EventLog::append(Category category, Level level, const char* format, int argCount,
+                      qreal a, qreal b, qreal c, qreal d)
+{
+  if (level < (int)m_levels[category]) {
+    return;
+  }
+  if (!allowed(category)) {
+    m_suppressed.fetchAndAddRelaxed(1);
+    return;
+  }
+
+  Slot *slot;
+  int position = m_enqueuePosition;
+  forever {
+    slot = &m_slots[position & (SlotCount - 1)];
+    int difference = slot->sequence.fetchAndAddAcquire(0) - position;
+    if (difference == 0) {
+      if (m_enqueuePosition.testAndSetRelaxed(position, position + 1)) {
+        break;
+      }
+      position = m_enqueuePosition;
+    } else if (difference < 0) {
+      // Full
+      m_dropped.fetchAndAddRelaxed(1);
+      return;
+    } else {
+      position = m_enqueuePosition;
+    }
+  }
+
+  Event &event = slot->event;
+  event.time = monotonicTime() - m_started;
+  event.format = format;
+  event.category = category;
+  event.level = level;
+  event.argCount = argCount;
+  event.args[0] = a;
+  event.args[1] = b;
+  event.args[2] = c;
+  event.args[3] = d;
+  slot->sequence.fetchAndStoreRelease(position + 1);
+}
+
+bool EventLog::writeNext()
+{
+  Slot &slot = m_slots[m_dequeuePosition & (SlotCount - 1)];
+  if (slot.sequence.fetchAndAddAcquire(0) - (m_dequeuePosition + 1) < 0) {
+    return false;
+  }
+  Event event = slot.event;
+  slot.sequence.fetchAndStoreRelease(m_dequeuePosition + SlotCount);
+  m_dequeuePosition++;
+
+  QString message = QString::fromLatin1(event.format);
+  for (int i=0; i<event.argCount; i++) {
+    // Steps and counts in full, 'g' would turn step 120000000 into 1.2e+08
+    double value = event.args[i];
+    if (value == floor(value) && fabs(value) < 1e15) {
+      message = message.arg(value, 0, 'f', 0);
+    } else {
+      message = message.arg(value, 0, 'g', 8);
+    }
+  }
+  fprintf(stderr, "%9.3f %-8s %s\n", event.time / 1e9, categoryNames[event.category],
+          message.toLocal8Bit().constData());
+  m_written.fetchAndAddRelease(1);
+  return true;
+}
+
+void EventLog::run()
+{
+  int dropped = 0;
+  int suppressed = 0;
+  qint64 lastReport = 0;
+  forever {
+    bool wrote = false;
+    while (writeNext()) {
+      wrote = true;
+    }
+    if (wrote) {
+      fflush(stderr);
+    }
+
+    // Losses are summed up once a second
+    qint64 now = monotonicTime();
+    if (now - lastReport > 1000000000 && ((int)m_dropped != dropped || (int)m_suppressed != suppressed)) {
+      fprintf(stderr, "%d log events dropped, %d over the rate limit\n",
+              (int)m_dropped - dropped, (int)m_suppressed - suppressed);
+      dropped = m_dropped;
+      suppressed = m_suppressed;
+      lastReport = now;
+    }
+
+    if (m_stopping && !wrote) {
+      return;
+    }
+    if (!wrote) {
+      msleep(IdleSleep);
+    }
+  }
+}
+
+void EventLog::flush()
+{
+  while ((int)m_written != m_enqueuePosition.fetchAndAddAcquire(0)) {
+    msleep(1);
+  }
+}
+
+int EventLog::dropped() const
+{
+  return m_dropped;
+}
+int EventLog::suppressed() const
+{
+  return m_suppressed;
+}
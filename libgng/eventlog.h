@@ -0,0 +1,114 @@
+#ifndef GNG_EVENTLOG_H
+#define GNG_EVENTLOG_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QString>
+
+namespace GNG {
+
+  /**
+      Logging for the training path. A log call checks the level and rate
+      limit of its category, copies the format pointer and up to four
+      numbers into a lock-free ring buffer and returns. A background
+      thread formats the events and writes them to stderr, so a slow
+      terminal or a full pipe never holds up a GNG step. When the ring is
+      full events are dropped and counted instead.
+
+      Formats are string literals with %1 to %4 placeholders, filled in
+      with QString::arg() on the background thread:
+
+        EventLog::log(EventLog::Topology, EventLog::Debug, "Node inserted at step %1", step);
+
+      Levels and rate limits are per category. They can be set from the
+      environment, e.g. GNG_LOG=topology=debug,training=warning and
+      GNG_LOG_RATE=100 (events per second and category, 0 for no limit).
+  */
+  class EventLog : public QThread {
+
+    public:
+      enum Category {
+        Training, /**< Progress of the run */
+        Topology, /**< Nodes and edges coming and going */
+        Source,   /**< Point sources */
+        CategoryCount
+      };
+      enum Level {
+        Debug,
+        Info,
+        Warning,
+        Off
+      };
+
+      /** The log, started on first use */
+      static EventLog* instance();
+
+      static void log(Category category, Level level, const char *format)
+      { instance()->append(category, level, format, 0, 0, 0, 0, 0); }
+      static void log(Category category, Level level, const char *format, qreal a)
+      { instance()->append(category, level, format, 1, a, 0, 0, 0); }
+      static void log(Category category, Level level, const char *format, qreal a, qreal b)
+      { instance()->append(category, level, format, 2, a, b, 0, 0); }
+      static void log(Category category, Level level, const char *format, qreal a, qreal b, qreal c)
+      { instance()->append(category, level, format, 3, a, b, c, 0); }
+      static void log(Category category, Level level, const char *format, qreal a, qreal b, qreal c, qreal d)
+      { instance()->append(category, level, format, 4, a, b, c, d); }
+
+      void setLevel(Category category, Level level);
+      Level level(Category category) const;
+      /** Events per second let through per category, 0 for no limit */
+      void setRateLimit(Category category, int perSecond);
+      /** Parses "category=level,..." as in GNG_LOG */
+      void configure(const QString &spec);
+
+      /** Waits until everything logged so far is written */
+      void flush();
+
+      int dropped() const; /**< Events lost to a full ring */
+      int suppressed() const; /**< Events over the rate limit */
+
+    protected:
+      virtual void run();
+
+    private:
+      EventLog();
+      ~EventLog();
+
+      struct Event {
+        qint64 time;
+        const char *format;
+        int category;
+        int level;
+        int argCount;
+        qreal args[4];
+      };
+      struct Slot {
+        QAtomicInt sequence;
+        Event event;
+      };
+      static const int SlotCount = 4096; // a power of 2
+
+      void append(Category category, Level level, const char *format, int argCount,
+                  qreal a, qreal b, qreal c, qreal d);
+      bool allowed(Category category);
+      bool writeNext();
+
+      Slot m_slots[SlotCount];
+      QAtomicInt m_enqueuePosition;
+      int m_dequeuePosition; // background thread only
+
+      QAtomicInt m_levels[CategoryCount];
+      QAtomicInt m_rateLimits[CategoryCount];
+      QAtomicInt m_rateWindows[CategoryCount]; // second the counts are for
+      QAtomicInt m_rateCounts[CategoryCount];
+
+      QAtomicInt m_dropped;
+      QAtomicInt m_suppressed;
+      QAtomicInt m_written; // events handled by the background thread
+      QAtomicInt m_stopping;
+      qint64 m_started;
+  };
+
+}
+
+#endif // GNG_EVENTLOG_H
@@ -4,6 +4,12 @@
 #include "edge.h"
 #include "point.h"
 #include "pointsource.h"
+#include "checkpoint.h"
+#include "journal.h"
+#include "stepprofile.h"
+#include "eventlog.h"
+
+#include <libaibo/trace.h>
 
 #include <math.h>
 
@@ -12,13 +18,37 @@
 
 using namespace GNG;
 
+// Greedy winner searches are checked against the exact search this often
+static const int GreedyAuditInterval = 100;
+
 // constructor
 GrowingNeuralGas::GrowingNeuralGas(int dimension, qreal minimum, qreal maximum)
   : m_pointGenerator(0),
     m_pickCloseToCountdown(0),
     m_stopAtStep(0),
+    m_targetErrorStep(-1),
+    m_journal(0),
+    m_journalInterval(0),
+    m_profile(0),
+    m_greedySearch(false),
+    m_greedyRestarts(2),
+    m_lastWinner(0),
+    m_greedySearches(0),
+    m_greedyFallbacks(0),
+    m_greedyAudits(0),
+    m_greedyAgreements(0),
+    m_greedySecondAgreements(0),
+    m_greedyRandomState(Q_UINT64_C(0x9E3779B97F4A7C15)),
+    m_nodesInserted(0),
+    m_nodesRemoved(0),
+    m_edgesRemoved(0),
+    m_averageError(0),
     m_pastRuntime(0),
-    m_running(false)
+    m_running(false),
+    m_waitingForSource(false),
+    m_staticStepLimit(0),
+    m_lastChangeCount(-1),
+    m_stepsSinceChange(0)
 {
   
   // Hardcoded values from paper
@@ -56,6 +86,7 @@ GrowingNeuralGas::GrowingNeuralGas(int dimension, qreal minimum, qreal maximum)
 // destructor
 GrowingNeuralGas::~GrowingNeuralGas()
 {
+  delete m_profile;
 }
 
 void GrowingNeuralGas::start()
@@ -84,23 +115,77 @@ void GrowingNeuralGas::stopAt(int step)
 {
   m_stopAtStep = step;
 }
+int GrowingNeuralGas::targetErrorStep() const
+{
+  return m_targetErrorStep;
+}
+
+int GrowingNeuralGas::nodesInserted() const
+{
+  return m_nodesInserted;
+}
+int GrowingNeuralGas::nodesRemoved() const
+{
+  return m_nodesRemoved;
+}
+int GrowingNeuralGas::edgesRemoved() const
+{
+  return m_edgesRemoved;
+}
+qreal GrowingNeuralGas::lastAverageError() const
+{
+  return m_averageError;
+}
 // Perform one iteration of the GNG with the given source/traning point
 // The gng will find the two closest nodes, move them closer to the training
 // point and then possibly add new nodes.
 void GrowingNeuralGas::runSingleStep()
 {
+  TRACE_SCOPE("GrowingNeuralGas::runSingleStep");
   if (m_currentStep == m_stopAtStep) {
     return stop();
   }
+
+  // Sources that pace their points, like a real-time replay, are waited
+  // for on the idle timer so the GUI thread keeps running meanwhile
+  int wait = m_pointGenerator->waitTime();
+  if (wait > 0) {
+    m_idleTimer.setInterval(wait);
+    m_waitingForSource = true;
+    return;
+  }
+  if (m_waitingForSource) {
+    m_idleTimer.setInterval(0);
+    m_waitingForSource = false;
+  }
+  
+  // Pause while the source hasn't changed for a while
+  if (m_staticStepLimit > 0) {
+    int changes = m_pointGenerator->changeCount();
+    if (changes != m_lastChangeCount) {
+      m_lastChangeCount = changes;
+      m_stepsSinceChange = 0;
+      m_idleTimer.setInterval(0);
+    } else if (m_stepsSinceChange >= m_staticStepLimit) {
+      // Check back every few ms instead of spinning on the idle timer
+      m_idleTimer.setInterval(10);
+      return;
+    }
+    m_stepsSinceChange++;
+  }
   
+  GNG_PROFILE_BEGIN(m_profile);
   Point trainingPoint = m_pointGenerator->generatePoint();
+  GNG_PROFILE_PHASE(Sample);
 
   if (m_currentStep % 10000 == 0) {
-    qDebug() << "Step " << m_currentStep;
+    EventLog::log(EventLog::Training, EventLog::Info, "Step %1", m_currentStep);
   }
   
   QPair<GNG::Node*, GNG::Node*> winners = computeDistances(trainingPoint);
+  GNG_PROFILE_PHASE(WinnerSearch);
   incrementEdgeAges(winners.first);
+  GNG_PROFILE_PHASE(EdgeAging);
   
   // if the point is already the right color, don't touch it by moving its xy position all over the place.
   if (false && 0.01 > winners.first->location().colorDistanceTo(trainingPoint)) {
@@ -129,6 +214,7 @@ void GrowingNeuralGas::runSingleStep()
       connectNodes(winners.first, winners.second);
     }
 //   }
+  GNG_PROFILE_PHASE(Adaptation);
   
   // if GNG has not developed enough subgraphs, try lowering the target errorThreshold
   if (false && m_currentStep > 20000 && m_currentStep % 5000 == 0 && 
@@ -169,10 +255,20 @@ void GrowingNeuralGas::runSingleStep()
 //   }
   
   incrementEdgeHistory();
+  GNG_PROFILE_PHASE(History);
   removeOldEdges();
+  GNG_PROFILE_PHASE(OldEdgeRemoval);
   
-  if (averageError() > m_targetError && (m_stepsSinceLastInsert > m_minStepsBetweenInsertions)) {
-    qDebug() << "Creating new Node at timestep " << m_currentStep << " and error " << averageError();
+  qreal error = averageError();
+  m_averageError = error;
+  if (m_targetErrorStep < 0 && error <= m_targetError) {
+    m_targetErrorStep = m_currentStep;
+    EventLog::log(EventLog::Training, EventLog::Info, "Reached target error %1 at step %2 after %3 ms with %4 nodes",
+                  m_targetError, m_currentStep, elapsedTime(), m_nodes.size());
+  }
+
+  if (error > m_targetError && (m_stepsSinceLastInsert > m_minStepsBetweenInsertions)) {
+    EventLog::log(EventLog::Topology, EventLog::Debug, "Creating new node at step %1 with error %2", m_currentStep, error);
     m_stepsSinceLastInsert = 0;
     insertNode();
   }
@@ -188,9 +284,20 @@ void GrowingNeuralGas::runSingleStep()
 //     m_pickCloseToCountdown = 500;
 //   }
   
+  GNG_PROFILE_PHASE(Insertion);
+  
   reduceAllErrors();
+  GNG_PROFILE_PHASE(ErrorDecay);
   m_currentStep++;
   m_stepsSinceLastInsert++;
+
+  if (m_journal && m_currentStep % m_journalInterval == 0) {
+    m_journal->positions(m_currentStep, m_nodes);
+  }
+  
+  if (m_updateInterval > 0 && m_currentStep % m_updateInterval == 0) {
+    emit updated();
+  }
 }
 
 void GrowingNeuralGas::runManySteps(int steps)
@@ -200,6 +307,19 @@ void GrowingNeuralGas::runManySteps(int steps)
   }
 }
 
+int GrowingNeuralGas::runSynchronous(int steps)
+{
+  int started = m_currentStep;
+  for (int i=0; i<steps; i++) {
+    int step = m_currentStep;
+    runSingleStep();
+    if (m_currentStep == step) {
+      break;
+    }
+  }
+  return m_currentStep - started;
+}
+
 
 
 // converts gng to a string to print out
@@ -228,6 +348,33 @@ bool pairLessThan(const DistNodePair &s1, const DistNodePair &s2)
    
 // see header
 QPair< GNG::Node*, GNG::Node* > GrowingNeuralGas::computeDistances(const Point& point)
+{
+  NodePair winners;
+  if (m_greedySearch) {
+    winners = greedyWinners(point);
+    m_greedySearches++;
+    if (!winners.first) {
+      m_greedyFallbacks++;
+    } else if (m_greedySearches % GreedyAuditInterval == 0) {
+      // The second winner gets an edge to the first, so it counts too
+      NodePair exact = exactWinners(point);
+      m_greedyAudits++;
+      if (exact.first == winners.first) {
+        m_greedyAgreements++;
+      }
+      if (exact.second == winners.second) {
+        m_greedySecondAgreements++;
+      }
+    }
+  }
+  if (!winners.first) {
+    winners = exactWinners(point);
+  }
+  m_lastWinner = winners.first;
+  return winners;
+}
+
+NodePair GrowingNeuralGas::exactWinners(const Point& point)
 {
   QList<DistNodePair> dists;
   
@@ -239,10 +386,91 @@ QPair< GNG::Node*, GNG::Node* > GrowingNeuralGas::computeDistances(const Point&
   return QPair<GNG::Node*, GNG::Node*>(dists[0].second, dists[1].second);
 }
 
+// Keeps the two closest of the nodes offered
+static void keepBest(GNG::Node *node, qreal distance, NodePair *best, qreal *firstDistance, qreal *secondDistance)
+{
+  if (node == best->first || node == best->second) {
+    return;
+  }
+  if (distance < *firstDistance) {
+    best->second = best->first;
+    *secondDistance = *firstDistance;
+    best->first = node;
+    *firstDistance = distance;
+  } else if (distance < *secondDistance) {
+    best->second = node;
+    *secondDistance = distance;
+  }
+}
+
+void GrowingNeuralGas::greedyWalk(GNG::Node* start, const Point& point, NodePair* best,
+                                  qreal* firstDistance, qreal* secondDistance)
+{
+  GNG::Node *current = start;
+  qreal currentDistance = start->location().distanceTo(point);
+  keepBest(current, currentDistance, best, firstDistance, secondDistance);
+  forever {
+    GNG::Node *next = 0;
+    qreal nextDistance = currentDistance;
+    foreach (GNG::Node *neighbor, current->neighbors()) {
+      qreal distance = neighbor->location().distanceTo(point);
+      keepBest(neighbor, distance, best, firstDistance, secondDistance);
+      if (distance < nextDistance) {
+        next = neighbor;
+        nextDistance = distance;
+      }
+    }
+    if (!next) {
+      return;
+    }
+    current = next;
+    currentDistance = nextDistance;
+  }
+}
+
+NodePair GrowingNeuralGas::greedyWinners(const Point& point)
+{
+  if (!m_lastWinner) {
+    return NodePair(0, 0);
+  }
+  NodePair best(0, 0);
+  qreal firstDistance = HUGE_VAL;
+  qreal secondDistance = HUGE_VAL;
+  greedyWalk(m_lastWinner, point, &best, &firstDistance, &secondDistance);
+
+  // A restart that ends up closer means the walk got stuck
+  GNG::Node *found = best.first;
+  for (int i=0; i<m_greedyRestarts; i++) {
+    greedyWalk(m_nodes[greedyRandom(m_nodes.size())], point, &best, &firstDistance, &secondDistance);
+  }
+  if (best.first != found || !best.second) {
+    return NodePair(0, 0);
+  }
+  return best;
+}
+
+// xorshift64*, as in SyntheticSource
+int GrowingNeuralGas::greedyRandom(int limit)
+{
+  m_greedyRandomState ^= m_greedyRandomState >> 12;
+  m_greedyRandomState ^= m_greedyRandomState << 25;
+  m_greedyRandomState ^= m_greedyRandomState >> 27;
+  quint64 value = m_greedyRandomState * Q_UINT64_C(2685821657736338717);
+  return (value >> 33) % limit;
+}
+
+// Edges go by the source's clock when it has one, so a replay ages them
+// like the recorded run did
+int GrowingNeuralGas::clockTime() const
+{
+  int time = m_pointGenerator ? m_pointGenerator->clockTime() : -1;
+  return time >= 0 ? time : m_currentRuntime.elapsed();
+}
+
 // increments all edges of a node
 void GrowingNeuralGas::incrementEdgeAges(GNG::Node* node)
 {
-  int currentTime = m_currentRuntime.elapsed();
+  int currentTime = clockTime();
   foreach(Edge* edge, node->edges()) {
     edge->setLastUpdated(currentTime);
     edge->incrementAge();
@@ -253,14 +481,15 @@ void GrowingNeuralGas::incrementEdgeAges(GNG::Node* node)
 // Updates the history hash for each edge and removes old edges
 void GrowingNeuralGas::incrementEdgeHistory()
 {
-  int currentTime = m_currentRuntime.elapsed();
+  int currentTime = clockTime();
 
   bool deletedAnEdge = false; // delete at most one edge per function call
 
   foreach(GNG::Node* node, m_nodes) {
     foreach(Edge* edge, node->edges()) {
       if (!deletedAnEdge && (currentTime - edge->lastUpdated()) > 5000) { // if it's been more than 5 seconds
-        qDebug() << "removing edge that has been here for" << (currentTime - edge->lastUpdated()) << "ms" << edge->id();
+        EventLog::log(EventLog::Topology, EventLog::Debug, "Removing edge %1, unused for %2 ms",
+                      edge->id(), currentTime - edge->lastUpdated());
         GNG::Node *n1 = edge->to();
         GNG::Node *n2 = edge->from();
         
@@ -268,6 +497,11 @@ void GrowingNeuralGas::incrementEdgeHistory()
         Edge *e2 = n2->getEdgeTo(n1);
         n1->removeEdge(e1);
         n2->removeEdge(e2);
+        GNG_PROFILE_COUNT(m_profile, EdgesRemoved);
+        m_edgesRemoved++;
+        if (m_journal) {
+          m_journal->edgeRemoved(m_currentStep, n1, n2);
+        }
         
         m_uniqueEdges.removeAll(e1);
         m_uniqueEdges.removeAll(e2);
@@ -302,11 +536,16 @@ void GrowingNeuralGas::connectNodes(GNG::Node* a, GNG::Node* b)
   a->appendEdge(e1);
   b->appendEdge(e2);
   
-  int currentTime = m_currentRuntime.elapsed();
+  int currentTime = clockTime();
   e1->setLastUpdated(currentTime);
   e2->setLastUpdated(currentTime);
   
   m_uniqueEdges.append(e1);
+  GNG_PROFILE_COUNT(m_profile, EdgesConnected);
+
+  if (m_journal) {
+    m_journal->edgeConnected(m_currentStep, a, b);
+  }
 }
 
 /*****************************
@@ -325,6 +564,12 @@ void GrowingNeuralGas::disconnectNodes(GNG::Node* a, GNG::Node* b)
   
   m_uniqueEdges.removeAll(e1);
   m_uniqueEdges.removeAll(e2);
+  GNG_PROFILE_COUNT(m_profile, EdgesRemoved);
+  m_edgesRemoved++;
+
+  if (m_journal) {
+    m_journal->edgeRemoved(m_currentStep, a, b);
+  }
 }
 
 /*****************************
@@ -339,6 +584,14 @@ void GrowingNeuralGas::removeOldEdges()
   foreach(GNG::Node *node, m_nodes) {
     foreach(Edge *edge, node->edges()) {
       if (edge->age() > m_maxEdgeAge) {
+        // Both directions age together, so journal the pair once
+        if (edge->from()->id() < edge->to()->id()) {
+          GNG_PROFILE_COUNT(m_profile, EdgesRemoved);
+          m_edgesRemoved++;
+          if (m_journal) {
+            m_journal->edgeRemoved(m_currentStep, edge->from(), edge->to());
+          }
+        }
         m_uniqueEdges.removeAll(edge);
         node->removeEdge(edge);
         delete edge;
@@ -350,7 +603,15 @@ void GrowingNeuralGas::removeOldEdges()
   for (int i=m_nodes.length()-1; i>=0; i--) {
     GNG::Node *node = m_nodes[i];
     if (node->edges().isEmpty()) {
+      GNG_PROFILE_COUNT(m_profile, NodesRemoved);
+      m_nodesRemoved++;
+      if (m_journal) {
+        m_journal->nodeRemoved(m_currentStep, node);
+      }
       m_nodes.removeAll(node);
+      if (node == m_lastWinner) {
+        m_lastWinner = 0;
+      }
       delete node;
     }
   }
@@ -397,6 +658,11 @@ void GrowingNeuralGas::insertNode()
   Point newPoint = midpoint(worst->location(), worstNeighbor->location());
   GNG::Node *newNode = new GNG::Node(newPoint, m_dimension, m_min, m_max);
   m_nodes.append(newNode);
+  GNG_PROFILE_COUNT(m_profile, NodesInserted);
+  m_nodesInserted++;
+  if (m_journal) {
+    m_journal->nodeInserted(m_currentStep, newNode);
+  }
 
   connectNodes(newNode, worst);
   connectNodes(newNode, worstNeighbor);
@@ -432,6 +698,7 @@ QList< Subgraph > GrowingNeuralGas::subgraphs() const
  */
 void GrowingNeuralGas::generateSubgraphs()
 {
+  TRACE_SCOPE("GrowingNeuralGas::generateSubgraphs");
   QHash<GNG::Node*, bool> nodeDict;
 
   foreach(GNG::Node* node, m_nodes){
@@ -641,6 +908,108 @@ void GrowingNeuralGas::setPointGenerator(PointSource* pointGenerator)
   m_pointGenerator = pointGenerator;
 }
 
+void GrowingNeuralGas::setJournal(Journal* journal, int positionInterval)
+{
+  m_journal = journal;
+  m_journalInterval = qMax(positionInterval, 1);
+  if (!m_journal) {
+    return;
+  }
+
+  foreach(GNG::Node *node, m_nodes) {
+    m_journal->nodeInserted(m_currentStep, node);
+  }
+  foreach(Edge *edge, m_uniqueEdges) {
+    m_journal->edgeConnected(m_currentStep, edge->from(), edge->to());
+  }
+  m_journal->state(m_currentStep, m_nodes);
+}
+
+void GrowingNeuralGas::setProfiling(bool enabled)
+{
+  if (enabled && !StepProfile::compiledIn()) {
+    qWarning() << "Built without GNG_PROFILING, there is nothing to profile";
+  }
+  if (enabled && !m_profile) {
+    m_profile = new StepProfile;
+  } else if (!enabled) {
+    delete m_profile;
+    m_profile = 0;
+  }
+}
+
+const StepProfile* GrowingNeuralGas::profile() const
+{
+  return m_profile;
+}
+
+void GrowingNeuralGas::setGreedySearch(bool enabled, int restarts)
+{
+  m_greedySearch = enabled;
+  m_greedyRestarts = qMax(restarts, 0);
+}
+bool GrowingNeuralGas::greedySearch() const
+{
+  return m_greedySearch;
+}
+int GrowingNeuralGas::greedySearches() const
+{
+  return m_greedySearches;
+}
+int GrowingNeuralGas::greedyFallbacks() const
+{
+  return m_greedyFallbacks;
+}
+int GrowingNeuralGas::greedyAudits() const
+{
+  return m_greedyAudits;
+}
+int GrowingNeuralGas::greedyAgreements() const
+{
+  return m_greedyAgreements;
+}
+int GrowingNeuralGas::greedySecondAgreements() const
+{
+  return m_greedySecondAgreements;
+}
+
+void GrowingNeuralGas::clearNetwork()
+{
+  foreach(GNG::Node *node, m_nodes) {
+    qDeleteAll(node->edges());
+    delete node;
+  }
+  m_nodes.clear();
+  m_lastWinner = 0;
+  m_uniqueEdges.clear();
+  m_edgeHistory.clear();
+  m_subgraphs.clear();
+  m_followSubgraph = Subgraph();
+}
+
+bool GrowingNeuralGas::loadInitialNetwork(const QString& fileName, int edgeAge)
+{
+  if (!Checkpoint::load(this, fileName, Checkpoint::Network)) {
+    return false;
+  }
+
+  // Train as if this were a fresh GNG that happens to start with more nodes
+  m_currentStep = 0;
+  m_stepsSinceLastInsert = m_minStepsBetweenInsertions + 1;
+  m_targetErrorStep = -1;
+  m_pastRuntime = 0;
+  if (edgeAge >= 0) {
+    foreach(GNG::Node *node, m_nodes) {
+      foreach(Edge *edge, node->edges()) {
+        edge->setAge(edgeAge);
+      }
+    }
+  }
+
+  qDebug() << "Starting from" << m_nodes.size() << "nodes and" << m_uniqueEdges.size() << "edges in" << fileName;
+  return true;
+}
+
 
 // Getters
 int GrowingNeuralGas::delay() const{ return m_delay; }
@@ -657,6 +1026,8 @@ qreal GrowingNeuralGas::targetError() const{ return m_targetError; }
 qreal GrowingNeuralGas::errorReduction() const{ return 1-m_reduceErrorMultiplier; }
 qreal GrowingNeuralGas::insertErrorReduction() const{ return 1-m_insertErrorMultiplier; }
 
+int GrowingNeuralGas::staticStepLimit() const{ return m_staticStepLimit; }
+
 // Setters
 void GrowingNeuralGas::setDelay(int milliseconds) { m_delay = milliseconds; }
 void GrowingNeuralGas::setUpdateInterval(int steps) { m_updateInterval = steps; }
@@ -670,4 +1041,6 @@ void GrowingNeuralGas::setNodeInsertionDelay(int minStepsBetweenInsertions) { m_
 void GrowingNeuralGas::setTargetError(qreal targetAverageError) { m_targetError = targetAverageError; }
 
 void GrowingNeuralGas::setErrorReduction(qreal reduceErrorBy) { m_reduceErrorMultiplier = 1-reduceErrorBy; }
-void GrowingNeuralGas::setInsertErrorReduction(qreal reduceErrorBy) { m_insertErrorMultiplier = 1-reduceErrorBy; }
\ No newline at end of file
+void GrowingNeuralGas::setInsertErrorReduction(qreal reduceErrorBy) { m_insertErrorMultiplier = 1-reduceErrorBy; }
+
+void GrowingNeuralGas::setStaticStepLimit(int steps) { m_staticStepLimit = steps; }
\ No newline at end of file
@@ -19,20 +19,27 @@ namespace GNG {
   class Node;
   class Edge;
   class PointSource;
+  class Journal;
+  class StepProfile;
 
   typedef QPair<GNG::Node*, GNG::Node*> NodePair;
 
   class GrowingNeuralGas : public QObject {
     Q_OBJECT
+    friend class Checkpoint;
+    friend class JournalReader;
+    friend class Benchmark;
     Q_PROPERTY(int delay READ delay WRITE setDelay);
     Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval);
     Q_PROPERTY(qreal winnerLearnRate READ winnerLearnRate WRITE setWinnerLearnRate);
     Q_PROPERTY(qreal neighborLearnRate READ neighborLearnRate WRITE setNeighborLearnRate);
     Q_PROPERTY(int maxEdgeAge READ maxEdgeAge WRITE setMaxEdgeAge);
-    Q_PROPERTY(int maxEdgeColorDiff READ maxEdgeColorDiff WRITE setMaxEdgeColorDiff);
-    Q_PROPERTY(int targetError READ targetError WRITE setTargetError);
+    Q_PROPERTY(qreal maxEdgeColorDiff READ maxEdgeColorDiff WRITE setMaxEdgeColorDiff);
+    Q_PROPERTY(int nodeInsertionDelay READ nodeInsertionDelay WRITE setNodeInsertionDelay);
+    Q_PROPERTY(qreal targetError READ targetError WRITE setTargetError);
     Q_PROPERTY(qreal errorReduction READ errorReduction WRITE setErrorReduction);
     Q_PROPERTY(qreal insertErrorReduction READ insertErrorReduction WRITE setInsertErrorReduction);
+    Q_PROPERTY(int staticStepLimit READ staticStepLimit WRITE setStaticStepLimit);
     
     public:
       GrowingNeuralGas(int dimension, qreal minimum = 0, qreal maximum = 1);
@@ -43,6 +50,37 @@ namespace GNG {
       
       void setPointGenerator(PointSource *pointGenerator);
 
+      /** Records every change to the topology, the node positions every
+          positionInterval steps and the node errors and edge ages every
+          Journal::StateInterval times that, to the journal. Attach it after loading a
+          network: the current network is recorded as the starting point. Pass 0 to stop */
+      void setJournal(Journal *journal, int positionInterval = 100);
+
+      /** Times every phase of a step. Only available when built with GNG_PROFILING */
+      void setProfiling(bool enabled);
+      const StepProfile* profile() const; /**< 0 unless profiling */
+
+      /** Finds the winners by walking the edges from the last winner to
+          closer and closer neighbors, instead of measuring every node. Walks
+          from restarts random nodes check the result; if one of them ends
+          somewhere closer, that step falls back to the exact search. The
+          second winner is only the second closest node the walks passed,
+          which can miss the true one even when the winner is right. Every
+          hundredth search is compared with the exact search, for both */
+      void setGreedySearch(bool enabled, int restarts = 2);
+      bool greedySearch() const;
+      int greedySearches() const;
+      int greedyFallbacks() const; /**< Searches that fell back to the exact search */
+      int greedyAudits() const; /**< Searches compared with the exact search */
+      int greedyAgreements() const; /**< Compared searches that found the same winner */
+      int greedySecondAgreements() const; /**< Compared searches that found the same second winner */
+
+      /** Starts from the network saved in a checkpoint instead of two random
+          nodes. The step counter starts over. An edgeAge of 0 or more replaces
+          the saved edge ages; close to maxEdgeAge(), edges the new input
+          doesn't confirm are pruned within a few steps */
+      bool loadInitialNetwork(const QString &fileName, int edgeAge = -1);
+
       QList<Subgraph> subgraphs() const;
       void generateSubgraphs();
       void matchingSubgraph();
@@ -58,6 +96,17 @@ namespace GNG {
       int currentStep() const; /**< Returns the current step of the computation. Reset when run() or runSynchronous() is called */
       
       void stopAt(int step);
+      /** Runs up to this many steps on the calling thread, for running many
+          GNGs side by side. Stops early at the stopAt() step, once the
+          source has been static for staticStepLimit() steps, or when the
+          source asks to wait. Returns the steps run */
+      int runSynchronous(int steps);
+      int targetErrorStep() const; /**< Step at which the average error first reached targetError(), -1 if it hasn't */
+
+      int nodesInserted() const; /**< Since construction */
+      int nodesRemoved() const;
+      int edgesRemoved() const;
+      qreal lastAverageError() const; /**< Average node error as of the last step */
 
       Point focusPoint() const;
       bool focusing() const;
@@ -77,6 +126,8 @@ namespace GNG {
       
       qreal errorReduction() const;
       qreal insertErrorReduction() const;
+      
+      int staticStepLimit() const;
 
       void setDelay(int milliseconds);
       void setUpdateInterval(int steps); /**< Emit signal updated() once per this number of steps */
@@ -92,6 +143,8 @@ namespace GNG {
       void setErrorReduction(qreal reduceErrorBy); /**< All errors are reduced by this amount each GNG step */
       void setInsertErrorReduction(qreal reduceErrorBy); /**< Reduce new unit's error by this much */
       
+      void setStaticStepLimit(int steps); /**< Pause after this many steps without a change in the source. 0 never pauses */
+      
       
     signals:
       void updated();    
@@ -114,6 +167,15 @@ namespace GNG {
       /** Computes the distances between the given point and every unit
           in the GNG.  Returns the closest and next closest units. */
       QPair<GNG::Node*, GNG::Node*> computeDistances(const Point& point); // find 2 best nodes
+      NodePair exactWinners(const Point &point);
+      /** The two best nodes seen walking the edges, (0, 0) if the walk can't be trusted */
+      NodePair greedyWinners(const Point &point);
+      /** Moves to the closest neighbor for as long as that is closer */
+      void greedyWalk(GNG::Node *start, const Point &point, NodePair *best, qreal *firstDistance, qreal *secondDistance);
+      /** Milliseconds edges are timed by */
+      int clockTime() const;
+      /** In [0, limit), from a generator of the GNG's own so restarts leave qrand() alone */
+      int greedyRandom(int limit);
       
       /** Increments the ages of every unit directly connected to the given unit. */
       void incrementEdgeAges(GNG::Node *node);
@@ -144,6 +206,9 @@ namespace GNG {
       void reduceAllErrors();
       
       void incrementEdgeHistory();
+
+      /** Deletes every node and edge */
+      void clearNetwork();
       
       /** Processes one input point at a time through the GNG. */
       void step(const Point& trainingPoint);
@@ -155,8 +220,10 @@ namespace GNG {
       
       int m_currentStep;
       int m_stopAtStep;
+      int m_targetErrorStep;
       bool m_running;
       QTimer m_idleTimer;
+      bool m_waitingForSource;
       
       int m_delay;
       int m_updateInterval;
@@ -174,6 +241,10 @@ namespace GNG {
       qreal m_targetError;
       qreal m_maxEdgeColorDiff;
       
+      int m_staticStepLimit;
+      int m_lastChangeCount;
+      int m_stepsSinceChange;
+      
       Point m_pickCloseTo;
       int m_pickCloseToCountdown;
       
@@ -182,6 +253,25 @@ namespace GNG {
       
       QHash<NodePair, int> m_edgeHistory;
       
+      Journal *m_journal;
+      int m_journalInterval;
+      StepProfile *m_profile;
+
+      bool m_greedySearch;
+      int m_greedyRestarts;
+      GNG::Node *m_lastWinner;
+      int m_greedySearches;
+      int m_greedyFallbacks;
+      int m_greedyAudits;
+      int m_greedyAgreements;
+      int m_greedySecondAgreements;
+      quint64 m_greedyRandomState;
+
+      int m_nodesInserted;
+      int m_nodesRemoved;
+      int m_edgesRemoved;
+      qreal m_averageError;
+
       QTime m_currentRuntime;
       int m_pastRuntime;
 
@@ -0,0 +1,99 @@
+// Checks the HSL kernels against QColor for every 24 bit color, checks
+// the YCbCr kernel against converting to RGB first, and times the
+// conversion of a 640x480 camera frame.
+
+#include "hslconvert.h"
+#include "hslimage.h"
+#include "clock.h"
+
+#include <QColor>
+#include <QVector>
+
+#include <cstdio>
+#include <cmath>
+
+using namespace GNG;
+
+int main(int, char**)
+{
+  printf("Using the %s kernel\n", hslKernelName());
+
+  // One row per red value, bgr and rgb order
+  QVector<uchar> bgr(3*256*256);
+  QVector<float> hue(256*256), saturation(256*256), lightness(256*256);
+  qreal worst = 0;
+  int mismatches = 0;
+
+  for (int red=0; red<256; red++) {
+    uchar *pixel = bgr.data();
+    for (int green=0; green<256; green++) {
+      for (int blue=0; blue<256; blue++) {
+        *pixel++ = blue;
+        *pixel++ = green;
+        *pixel++ = red;
+      }
+    }
+    bgrRowToHsl(bgr.constData(), 256*256, 3, hue.data(), saturation.data(), lightness.data());
+
+    for (int i=0; i<256*256; i++) {
+      qreal h, s, l;
+      QColor::fromRgb(red, i/256, i%256).toHsl().getHslF(&h, &s, &l);
+      if (h < 0) {
+        h = 0; // gray
+      }
+      qreal error = qMax(fabs(h - hue[i]), qMax(fabs(s - saturation[i]), fabs(l - lightness[i])));
+      worst = qMax(worst, error);
+      if (error > 1e-4 && mismatches++ < 10) {
+        printf("Mismatch for rgb(%d, %d, %d): %f %f %f, QColor gives %f %f %f\n",
+               red, i/256, i%256, hue[i], saturation[i], lightness[i], h, s, l);
+      }
+    }
+  }
+  printf("Largest difference to QColor: %g (%d above 1e-4)\n", worst, mismatches);
+
+  // YCbCr must give exactly what its rounded RGB gives
+  QVector<uchar> ycbcr(3*256*256), rgb(3*256*256);
+  QVector<float> hue2(256*256), saturation2(256*256), lightness2(256*256);
+  int yccMismatches = 0;
+  for (int cr=0; cr<256; cr++) {
+    uchar *pixel = ycbcr.data();
+    uchar *converted = rgb.data();
+    for (int luma=0; luma<256; luma++) {
+      for (int cb=0; cb<256; cb++) {
+        *pixel++ = luma;
+        *pixel++ = cb;
+        *pixel++ = cr;
+        *converted++ = rintf(qBound(0.0f, luma + 1.402f*(cr - 128.0f), 255.0f));
+        *converted++ = rintf(qBound(0.0f, luma - 0.344136f*(cb - 128.0f) - 0.714136f*(cr - 128.0f), 255.0f));
+        *converted++ = rintf(qBound(0.0f, luma + 1.772f*(cb - 128.0f), 255.0f));
+      }
+    }
+    ycbcrRowToHsl(ycbcr.constData(), 256*256, 3, hue.data(), saturation.data(), lightness.data());
+    rgbRowToHsl(rgb.constData(), 256*256, 3, hue2.data(), saturation2.data(), lightness2.data());
+    for (int i=0; i<256*256; i++) {
+      if (hue[i] != hue2[i] || saturation[i] != saturation2[i] || lightness[i] != lightness2[i]) {
+        yccMismatches++;
+      }
+    }
+  }
+  printf("YCbCr pixels that differ from converting through RGB: %d\n", yccMismatches);
+
+  // A noisy camera frame
+  const int width = 640, height = 480;
+  QVector<uchar> frame(3*width*height);
+  for (int i=0; i<frame.size(); i++) {
+    frame[i] = qrand();
+  }
+  HslImage converted;
+  const int runs = 200;
+  converted.convertBgr(frame.constData(), width, height, 3*width, 3); // warm up
+
+  qint64 start = monotonicTime();
+  for (int i=0; i<runs; i++) {
+    converted.convertBgr(frame.constData(), width, height, 3*width, 3);
+  }
+  qint64 elapsed = monotonicTime() - start;
+  printf("640x480 BGR frame: %.3f ms per conversion\n", elapsed/1e6/runs);
+
+  return mismatches == 0 && yccMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+#include "hslconvert.h"
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GNG_HSL_X86
+#include <immintrin.h>
+#endif
+
+using namespace GNG;
+
+// All kernels work on channel values in 0-255 and perform the same float
+// operations in the same order, so the vector kernels give bit identical
+// results to the scalar one.
+//
+// l = (max+min)/510
+// s = (max-min)/(max+min)        if l < 0.5
+//     (max-min)/(510-max-min)    otherwise
+// h = one sixth of the distance around the color wheel, as in QColor
+//
+// YCbCr pixels (JFIF, as decoded by libjpeg) are first turned into RGB
+// rounded to the nearest integer, so they follow the same path as pixels
+// that libjpeg converted to RGB itself.
+
+namespace {
+
+  typedef void (*RowFunction)(const uchar*, int, int, float*, float*, float*);
+
+  enum PixelOrder {
+    Rgb,
+    Bgr,
+    YCbCr
+  };
+
+  inline int yccChannel(float value)
+  {
+    return int(rintf(qBound(0.0f, value, 255.0f)));
+  }
+
+  inline void pixelToHsl(int r, int g, int b, float *h, float *s, float *l)
+  {
+    int max = qMax(r, qMax(g, b));
+    int min = qMin(r, qMin(g, b));
+    int delta = max - min;
+    int sum = max + min;
+
+    *l = sum * (1.0f/510);
+    if (delta == 0) {
+      // Gray: QColor reports a hue of -1, the sources have always used 0
+      *h = 0;
+      *s = 0;
+      return;
+    }
+
+    *s = float(delta) / float(sum < 255 ? sum : 510 - sum);
+
+    float hue;
+    if (r == max) {
+      hue = 0 + float(g - b) / float(delta);
+    } else if (g == max) {
+      hue = 2 + float(b - r) / float(delta);
+    } else {
+      hue = 4 + float(r - g) / float(delta);
+    }
+    hue *= 1.0f/6;
+    if (hue < 0) {
+      hue += 1;
+    }
+    *h = hue;
+  }
+
+  template <int Order>
+  void scalarRow(const uchar *src, int width, int bytesPerPixel, float *h, float *s, float *l)
+  {
+    for (int x=0; x<width; x++) {
+      const uchar *pixel = src + x*bytesPerPixel;
+      if (Order == Bgr) {
+        pixelToHsl(pixel[2], pixel[1], pixel[0], h+x, s+x, l+x);
+      } else if (Order == Rgb) {
+        pixelToHsl(pixel[0], pixel[1], pixel[2], h+x, s+x, l+x);
+      } else {
+        float y = pixel[0];
+        float cb = pixel[1] - 128.0f;
+        float cr = pixel[2] - 128.0f;
+        pixelToHsl(yccChannel(y + 1.402f*cr),
+                   yccChannel(y - 0.344136f*cb - 0.714136f*cr),
+                   yccChannel(y + 1.772f*cb),
+                   h+x, s+x, l+x);
+      }
+    }
+  }
+
+#ifdef GNG_HSL_X86
+
+  // Spreads 4 packed 3 byte pixels into the low bytes of 4 words
+  __attribute__((target("sse4.1")))
+  inline __m128i unpack3(const uchar *src)
+  {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle);
+  }
+
+  __attribute__((target("sse4.1")))
+  inline void hsl4(__m128 r, __m128 g, __m128 b, float *h, float *s, float *l)
+  {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1);
+
+    __m128 max = _mm_max_ps(r, _mm_max_ps(g, b));
+    __m128 min = _mm_min_ps(r, _mm_min_ps(g, b));
+    __m128 delta = _mm_sub_ps(max, min);
+    __m128 sum = _mm_add_ps(max, min);
+    __m128 gray = _mm_cmpeq_ps(delta, zero);
+
+    _mm_storeu_ps(l, _mm_mul_ps(sum, _mm_set1_ps(1.0f/510)));
+
+    // Gray pixels divide 0 by 1 to keep the lanes free of infinities
+    __m128 dark = _mm_cmplt_ps(sum, _mm_set1_ps(255));
+    __m128 denominator = _mm_blendv_ps(_mm_sub_ps(_mm_set1_ps(510), sum), sum, dark);
+    denominator = _mm_blendv_ps(denominator, one, gray);
+    _mm_storeu_ps(s, _mm_div_ps(delta, denominator));
+
+    __m128 redMax = _mm_cmpeq_ps(r, max);
+    __m128 greenMax = _mm_cmpeq_ps(g, max);
+    __m128 numerator = _mm_blendv_ps(_mm_sub_ps(r, g), _mm_sub_ps(b, r), greenMax);
+    numerator = _mm_blendv_ps(numerator, _mm_sub_ps(g, b), redMax);
+    __m128 offset = _mm_blendv_ps(_mm_set1_ps(4), _mm_set1_ps(2), greenMax);
+    offset = _mm_blendv_ps(offset, zero, redMax);
+
+    __m128 hue = _mm_add_ps(offset, _mm_div_ps(numerator, _mm_blendv_ps(delta, one, gray)));
+    hue = _mm_mul_ps(hue, _mm_set1_ps(1.0f/6));
+    hue = _mm_add_ps(hue, _mm_and_ps(_mm_cmplt_ps(hue, zero), one));
+    _mm_storeu_ps(h, _mm_blendv_ps(hue, zero, gray));
+  }
+
+  __attribute__((target("sse4.1")))
+  inline __m128 yccChannel4(__m128 value)
+  {
+    value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(255));
+    return _mm_round_ps(value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+
+  template <int Order>
+  __attribute__((target("sse4.1")))
+  inline void pixels4(__m128 c0, __m128 c1, __m128 c2, float *h, float *s, float *l)
+  {
+    if (Order == Bgr) {
+      hsl4(c2, c1, c0, h, s, l);
+    } else if (Order == Rgb) {
+      hsl4(c0, c1, c2, h, s, l);
+    } else {
+      __m128 cb = _mm_sub_ps(c1, _mm_set1_ps(128));
+      __m128 cr = _mm_sub_ps(c2, _mm_set1_ps(128));
+      __m128 r = _mm_add_ps(c0, _mm_mul_ps(_mm_set1_ps(1.402f), cr));
+      __m128 g = _mm_sub_ps(_mm_sub_ps(c0, _mm_mul_ps(_mm_set1_ps(0.344136f), cb)),
+                            _mm_mul_ps(_mm_set1_ps(0.714136f), cr));
+      __m128 b = _mm_add_ps(c0, _mm_mul_ps(_mm_set1_ps(1.772f), cb));
+      hsl4(yccChannel4(r), yccChannel4(g), yccChannel4(b), h, s, l);
+    }
+  }
+
+  template <int Order>
+  __attribute__((target("sse4.1")))
+  void sse41Row(const uchar *src, int width, int bytesPerPixel, float *h, float *s, float *l)
+  {
+    const __m128i low = _mm_set1_epi32(0xff);
+    int x = 0;
+
+    if (bytesPerPixel == 3 || bytesPerPixel == 4) {
+      // 3 byte pixels load 16 bytes for 12, so stay clear of the row end
+      int last = bytesPerPixel == 4 ? width - 4 : width - 6;
+      for (; x <= last; x += 4) {
+        const uchar *pixel = src + x*bytesPerPixel;
+        __m128i words = bytesPerPixel == 4 ? _mm_loadu_si128((const __m128i*)pixel) : unpack3(pixel);
+        __m128 c0 = _mm_cvtepi32_ps(_mm_and_si128(words, low));
+        __m128 c1 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(words, 8), low));
+        __m128 c2 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(words, 16), low));
+        pixels4<Order>(c0, c1, c2, h+x, s+x, l+x);
+      }
+    }
+
+    scalarRow<Order>(src + x*bytesPerPixel, width - x, bytesPerPixel, h+x, s+x, l+x);
+  }
+
+  __attribute__((target("avx2")))
+  inline void hsl8(__m256 r, __m256 g, __m256 b, float *h, float *s, float *l)
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1);
+
+    __m256 max = _mm256_max_ps(r, _mm256_max_ps(g, b));
+    __m256 min = _mm256_min_ps(r, _mm256_min_ps(g, b));
+    __m256 delta = _mm256_sub_ps(max, min);
+    __m256 sum = _mm256_add_ps(max, min);
+    __m256 gray = _mm256_cmp_ps(delta, zero, _CMP_EQ_OQ);
+
+    _mm256_storeu_ps(l, _mm256_mul_ps(sum, _mm256_set1_ps(1.0f/510)));
+
+    __m256 dark = _mm256_cmp_ps(sum, _mm256_set1_ps(255), _CMP_LT_OQ);
+    __m256 denominator = _mm256_blendv_ps(_mm256_sub_ps(_mm256_set1_ps(510), sum), sum, dark);
+    denominator = _mm256_blendv_ps(denominator, one, gray);
+    _mm256_storeu_ps(s, _mm256_div_ps(delta, denominator));
+
+    __m256 redMax = _mm256_cmp_ps(r, max, _CMP_EQ_OQ);
+    __m256 greenMax = _mm256_cmp_ps(g, max, _CMP_EQ_OQ);
+    __m256 numerator = _mm256_blendv_ps(_mm256_sub_ps(r, g), _mm256_sub_ps(b, r), greenMax);
+    numerator = _mm256_blendv_ps(numerator, _mm256_sub_ps(g, b), redMax);
+    __m256 offset = _mm256_blendv_ps(_mm256_set1_ps(4), _mm256_set1_ps(2), greenMax);
+    offset = _mm256_blendv_ps(offset, zero, redMax);
+
+    __m256 hue = _mm256_add_ps(offset, _mm256_div_ps(numerator, _mm256_blendv_ps(delta, one, gray)));
+    hue = _mm256_mul_ps(hue, _mm256_set1_ps(1.0f/6));
+    hue = _mm256_add_ps(hue, _mm256_and_ps(_mm256_cmp_ps(hue, zero, _CMP_LT_OQ), one));
+    _mm256_storeu_ps(h, _mm256_blendv_ps(hue, zero, gray));
+  }
+
+  __attribute__((target("avx2")))
+  inline __m256 yccChannel8(__m256 value)
+  {
+    value = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(255));
+    return _mm256_round_ps(value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  }
+
+  template <int Order>
+  __attribute__((target("avx2")))
+  inline void pixels8(__m256 c0, __m256 c1, __m256 c2, float *h, float *s, float *l)
+  {
+    if (Order == Bgr) {
+      hsl8(c2, c1, c0, h, s, l);
+    } else if (Order == Rgb) {
+      hsl8(c0, c1, c2, h, s, l);
+    } else {
+      __m256 cb = _mm256_sub_ps(c1, _mm256_set1_ps(128));
+      __m256 cr = _mm256_sub_ps(c2, _mm256_set1_ps(128));
+      __m256 r = _mm256_add_ps(c0, _mm256_mul_ps(_mm256_set1_ps(1.402f), cr));
+      __m256 g = _mm256_sub_ps(_mm256_sub_ps(c0, _mm256_mul_ps(_mm256_set1_ps(0.344136f), cb)),
+                               _mm256_mul_ps(_mm256_set1_ps(0.714136f), cr));
+      __m256 b = _mm256_add_ps(c0, _mm256_mul_ps(_mm256_set1_ps(1.772f), cb));
+      hsl8(yccChannel8(r), yccChannel8(g), yccChannel8(b), h, s, l);
+    }
+  }
+
+  template <int Order>
+  __attribute__((target("avx2")))
+  void avx2Row(const uchar *src, int width, int bytesPerPixel, float *h, float *s, float *l)
+  {
+    const __m256i low = _mm256_set1_epi32(0xff);
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    int x = 0;
+
+    if (bytesPerPixel == 3 || bytesPerPixel == 4) {
+      // 3 byte pixels read 4 bytes past the 8th pixel
+      int last = bytesPerPixel == 4 ? width - 8 : width - 10;
+      for (; x <= last; x += 8) {
+        const uchar *pixel = src + x*bytesPerPixel;
+        __m256i words;
+        if (bytesPerPixel == 4) {
+          words = _mm256_loadu_si256((const __m256i*)pixel);
+        } else {
+          __m128i first = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pixel), shuffle);
+          __m128i second = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(pixel + 12)), shuffle);
+          words = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        }
+        __m256 c0 = _mm256_cvtepi32_ps(_mm256_and_si256(words, low));
+        __m256 c1 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(words, 8), low));
+        __m256 c2 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(words, 16), low));
+        pixels8<Order>(c0, c1, c2, h+x, s+x, l+x);
+      }
+    }
+
+    scalarRow<Order>(src + x*bytesPerPixel, width - x, bytesPerPixel, h+x, s+x, l+x);
+  }
+
+#endif // GNG_HSL_X86
+
+  struct Kernel {
+    RowFunction bgr;
+    RowFunction rgb;
+    RowFunction ycbcr;
+    const char *name;
+  };
+
+  Kernel pickKernel()
+  {
+    Kernel kernel = { scalarRow<Bgr>, scalarRow<Rgb>, scalarRow<YCbCr>, "scalar" };
+#ifdef GNG_HSL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      kernel.bgr = avx2Row<Bgr>;
+      kernel.rgb = avx2Row<Rgb>;
+      kernel.ycbcr = avx2Row<YCbCr>;
+      kernel.name = "avx2";
+    } else if (__builtin_cpu_supports("sse4.1")) {
+      kernel.bgr = sse41Row<Bgr>;
+      kernel.rgb = sse41Row<Rgb>;
+      kernel.ycbcr = sse41Row<YCbCr>;
+      kernel.name = "sse4.1";
+    }
+#endif
+    return kernel;
+  }
+
+  const Kernel& kernel()
+  {
+    static const Kernel kernel = pickKernel();
+    return kernel;
+  }
+
+}
+
+void GNG::bgrRowToHsl(const uchar* src, int width, int bytesPerPixel,
+                      float* hue, float* saturation, float* lightness)
+{
+  kernel().bgr(src, width, bytesPerPixel, hue, saturation, lightness);
+}
+
+void GNG::rgbRowToHsl(const uchar* src, int width, int bytesPerPixel,
+                      float* hue, float* saturation, float* lightness)
+{
+  kernel().rgb(src, width, bytesPerPixel, hue, saturation, lightness);
+}
+
+void GNG::ycbcrRowToHsl(const uchar* src, int width, int bytesPerPixel,
+                        float* hue, float* saturation, float* lightness)
+{
+  kernel().ycbcr(src, width, bytesPerPixel, hue, saturation, lightness);
+}
+
+const char* GNG::hslKernelName()
+{
+  return kernel().name;
+}
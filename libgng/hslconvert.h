@@ -0,0 +1,30 @@
+#ifndef GNG_HSLCONVERT_H
+#define GNG_HSLCONVERT_H
+
+#include <QtGlobal>
+
+namespace GNG {
+
+  /** Converts a row of 8 bit BGR pixels into hue, saturation and lightness
+      planes, each in [0,1]. Matches QColor::getHslF() except that gray
+      pixels get a hue of 0 instead of -1. bytesPerPixel is 3 for OpenCV
+      frames and 4 for QImage::Format_RGB32 (stored B G R A in memory) */
+  void bgrRowToHsl(const uchar *src, int width, int bytesPerPixel,
+                   float *hue, float *saturation, float *lightness);
+
+  /** Same as bgrRowToHsl() for pixels stored in R G B order */
+  void rgbRowToHsl(const uchar *src, int width, int bytesPerPixel,
+                   float *hue, float *saturation, float *lightness);
+
+  /** Converts a row of JFIF YCbCr pixels, as libjpeg decodes them with
+      JCS_YCbCr, to HSL. The same as converting them to RGB rounded to
+      integers and calling rgbRowToHsl() */
+  void ycbcrRowToHsl(const uchar *src, int width, int bytesPerPixel,
+                     float *hue, float *saturation, float *lightness);
+
+  /** Name of the kernel picked for this cpu: "avx2", "sse4.1" or "scalar" */
+  const char* hslKernelName();
+
+}
+
+#endif //GNG_HSLCONVERT_H
@@ -0,0 +1,104 @@
+#include "hslimage.h"
+#include "hslconvert.h"
+
+using namespace GNG;
+
+HslImage::HslImage()
+  : m_width(0),
+    m_height(0)
+{
+}
+
+void HslImage::resize(int width, int height)
+{
+  if (width == m_width && height == m_height) {
+    return;
+  }
+  m_width = width;
+  m_height = height;
+  m_hue.resize(width*height);
+  m_saturation.resize(width*height);
+  m_lightness.resize(width*height);
+}
+
+void HslImage::convertBgr(const uchar* data, int width, int height, int bytesPerLine, int bytesPerPixel)
+{
+  resize(width, height);
+  for (int y=0; y<height; y++) {
+    int offset = y*width;
+    bgrRowToHsl(data + y*bytesPerLine, width, bytesPerPixel,
+                m_hue.data() + offset, m_saturation.data() + offset, m_lightness.data() + offset);
+  }
+}
+
+void HslImage::convertRgb(const uchar* data, int width, int height, int bytesPerLine, int bytesPerPixel)
+{
+  resize(width, height);
+  for (int y=0; y<height; y++) {
+    int offset = y*width;
+    rgbRowToHsl(data + y*bytesPerLine, width, bytesPerPixel,
+                m_hue.data() + offset, m_saturation.data() + offset, m_lightness.data() + offset);
+  }
+}
+
+void HslImage::convertYCbCr(const uchar* data, int width, int height, int bytesPerLine)
+{
+  resize(width, height);
+  for (int y=0; y<height; y++) {
+    int offset = y*width;
+    ycbcrRowToHsl(data + y*bytesPerLine, width, 3,
+                  m_hue.data() + offset, m_saturation.data() + offset, m_lightness.data() + offset);
+  }
+}
+
+void HslImage::convert(const QImage& image)
+{
+  QImage rgb = image;
+  if (rgb.format() != QImage::Format_RGB32 && rgb.format() != QImage::Format_ARGB32) {
+    rgb = image.convertToFormat(QImage::Format_RGB32);
+  }
+  
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+  // 0xAARRGGBB words are stored B G R A
+  convertBgr(rgb.constBits(), rgb.width(), rgb.height(), rgb.bytesPerLine(), 4);
+#else
+  // and A R G B on big endian machines
+  convertRgb(rgb.constBits() + 1, rgb.width(), rgb.height(), rgb.bytesPerLine(), 4);
+#endif
+}
+
+bool HslImage::isNull() const
+{
+  return m_width == 0 || m_height == 0;
+}
+
+int HslImage::width() const
+{
+  return m_width;
+}
+
+int HslImage::height() const
+{
+  return m_height;
+}
+
+void HslImage::hsl(int x, int y, qreal* hue, qreal* saturation, qreal* lightness) const
+{
+  int index = y*m_width + x;
+  *hue = m_hue.at(index);
+  *saturation = m_saturation.at(index);
+  *lightness = m_lightness.at(index);
+}
+
+const float* HslImage::hue() const
+{
+  return m_hue.constData();
+}
+const float* HslImage::saturation() const
+{
+  return m_saturation.constData();
+}
+const float* HslImage::lightness() const
+{
+  return m_lightness.constData();
+}
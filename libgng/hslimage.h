@@ -0,0 +1,51 @@
+#ifndef GNG_HSLIMAGE_H
+#define GNG_HSLIMAGE_H
+
+#include <QImage>
+#include <QVector>
+
+namespace GNG {
+
+  /**
+      A frame converted to HSL once, as three float planes. Sources convert
+      every frame when it arrives and then sample from the planes instead
+      of converting single pixels through QColor.
+  */
+  class HslImage {
+
+    public:
+      HslImage();
+
+      /** Converts 8 bit BGR pixels. bytesPerPixel is 3 for OpenCV frames */
+      void convertBgr(const uchar *data, int width, int height, int bytesPerLine, int bytesPerPixel);
+      /** Converts 8 bit RGB pixels */
+      void convertRgb(const uchar *data, int width, int height, int bytesPerLine, int bytesPerPixel);
+      /** Converts 8 bit JFIF YCbCr pixels, 3 bytes each, as libjpeg decodes them */
+      void convertYCbCr(const uchar *data, int width, int height, int bytesPerLine);
+      /** Converts a QImage of any format */
+      void convert(const QImage &image);
+
+      bool isNull() const;
+      int width() const;
+      int height() const;
+
+      /** The same values as QColor::getHslF(), except gray has a hue of 0 */
+      void hsl(int x, int y, qreal *hue, qreal *saturation, qreal *lightness) const;
+
+      const float* hue() const;
+      const float* saturation() const;
+      const float* lightness() const;
+
+    private:
+      void resize(int width, int height);
+
+      int m_width;
+      int m_height;
+      QVector<float> m_hue;
+      QVector<float> m_saturation;
+      QVector<float> m_lightness;
+  };
+
+}
+
+#endif //GNG_HSLIMAGE_H
@@ -1,20 +1,27 @@
 
 #include "imagesource.h"
+#include "backgroundmodel.h"
+#include "motionmap.h"
 
 #include <math.h>
 
 #include <QDebug>
 #include <QList>
-#include <QColor>
 #include <QMutex>
 
 using namespace GNG;
 
 ImageSource::ImageSource(const QImage& image)
 : PointSource(),
-  m_image(image)
+  m_image(image),
+  m_background(0),
+  m_motion(0),
+  m_changeCount(1),
+  m_pyramidLevels(1),
+  m_level(0)
 {
   m_dataAccess = new QMutex();
+  m_hsl.convert(m_image);
 }
 
 ImageSource::~ImageSource()
@@ -26,46 +33,125 @@ void ImageSource::setImage(const QImage& image)
 {
   m_dataAccess->lock();
   m_image = image;
+  m_hsl.convert(m_image);
+  buildPyramid();
+  if (m_background) {
+    m_background->update(m_image);
+  }
+  if (!m_motion || m_motion->update(m_hsl)) {
+    m_changeCount++;
+  }
+  m_dataAccess->unlock();
+}
+
+void ImageSource::setBackgroundModel(BackgroundModel* model)
+{
+  m_dataAccess->lock();
+  m_background = model;
+  if (m_background) {
+    m_background->update(m_image);
+  }
   m_dataAccess->unlock();
 }
 
+void ImageSource::setMotionMap(MotionMap* motion)
+{
+  m_dataAccess->lock();
+  m_motion = motion;
+  if (m_motion) {
+    m_motion->update(m_hsl);
+  }
+  m_dataAccess->unlock();
+}
+
+void ImageSource::setPyramidLevels(int levels)
+{
+  m_dataAccess->lock();
+  m_pyramidLevels = qMax(levels, 1);
+  m_level = qMin(m_level, m_pyramidLevels - 1);
+  buildPyramid();
+  m_dataAccess->unlock();
+}
+
+int ImageSource::pyramidLevels() const
+{
+  return m_pyramidLevels;
+}
+
+void ImageSource::setLevel(int level)
+{
+  m_dataAccess->lock();
+  m_level = qBound(0, level, m_pyramidLevels - 1);
+  m_dataAccess->unlock();
+}
+
+int ImageSource::level() const
+{
+  return m_level;
+}
+
+// Each level is smoothly scaled down from the one before, so its pixels
+// average the ones they cover. Called with the lock held
+void ImageSource::buildPyramid()
+{
+  m_pyramid.clear();
+  QImage level = m_image;
+  for (int i=1; i<m_pyramidLevels; i++) {
+    level = level.scaled(qMax(level.width()/2, 1), qMax(level.height()/2, 1),
+                         Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    HslImage hsl;
+    hsl.convert(level);
+    m_pyramid.append(hsl);
+  }
+}
+
 int ImageSource::dimension()
 {
   return 5;
 }
 
+int ImageSource::changeCount()
+{
+  return m_changeCount;
+}
+
 Point ImageSource::pointFromXY(int x, int y)
 {
   Point p(dimension());
   p[0] = normalize(x, width());
   p[1] = normalize(y, height());
 
+  // Converted once per image by setImage()
   m_dataAccess->lock();
-  QColor colors = m_image.pixel(x, y);
-  m_dataAccess->unlock();
-  //colors = colors.toHsv();
-  colors = colors.toHsl();
-  //colors.getHsvF(&p[2], &p[3], &p[4]);
-  colors.getHslF(&p[2], &p[3], &p[4]);
-  
-  if (p[2] < 0) {
-    p[2] = 0; // qt returns hue == -1 if the color is a gray/black/white
+  if (m_level == 0) {
+    m_hsl.hsl(x, y, &p[2], &p[3], &p[4]);
+  } else {
+    const HslImage &level = m_pyramid.at(m_level - 1);
+    level.hsl(x*level.width()/m_hsl.width(), y*level.height()/m_hsl.height(), &p[2], &p[3], &p[4]);
   }
+  m_dataAccess->unlock();
 
   return p;
 }
 
 Point ImageSource::generatePoint()
 {
-  int x = qrand() % width();
-  int y = qrand() % height();
-      
-    //     if ((abs(colors.hue() - backgroundColor[0]) > 50)
-    //      || (abs(colors.saturation() - backgroundColor[1]) > 50)
-    //      || (abs(colors.value() - backgroundColor[2]) > 50)) {
-    //if ((abs(colors.saturation() - backgroundColor[0]) > 10)) {
-    //  backgroundPoint = false;
-    //}
+  int x, y;
+
+  // Part of the samples go to whatever changed since the last image, as
+  // long as the change is not background. The rest are drawn straight
+  // from the precomputed foreground pixels, or from the whole image if
+  // there is no model or everything is background.
+  m_dataAccess->lock();
+  bool picked = (m_motion && m_motion->pickChangedPixel(&x, &y)
+                 && (!m_background || m_background->isForeground(x, y)))
+             || (m_background && m_background->randomForegroundPixel(&x, &y));
+  m_dataAccess->unlock();
+
+  if (!picked) {
+    x = qrand() % width();
+    y = qrand() % height();
+  }
 
   return pointFromXY(x, y);
 }
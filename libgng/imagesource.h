@@ -5,12 +5,16 @@
 #include <QString>
 #include <QImage>
 #include <QThread>
+#include <QList>
 
 #include "pointsource.h"
+#include "hslimage.h"
 
 class QMutex;
 
 namespace GNG {
+  class BackgroundModel;
+  class MotionMap;
 
   class ImageSource : public QThread, public PointSource { 
     public:
@@ -18,10 +22,26 @@ namespace GNG {
       ~ImageSource();
 
       void setImage(const QImage &image);
+      /** Only sample pixels that the model classifies as foreground. Pass 0 to sample every pixel */
+      void setBackgroundModel(BackgroundModel *model);
+      /** Draw part of the samples from the regions that changed since the last image. Pass 0 to disable */
+      void setMotionMap(MotionMap *motion);
+
+      /** Keeps levels-1 smaller copies of every image, each half the size
+          of the one before, for training coarse to fine. 1 keeps only the
+          image itself */
+      void setPyramidLevels(int levels);
+      int pyramidLevels() const;
+      /** Level the colors are sampled from, 0 being the image itself.
+          Points keep the coordinates of the full image: a pixel is picked
+          as on level 0 and takes the color of the coarse pixel covering it */
+      void setLevel(int level);
+      int level() const;
       
       virtual Point generatePoint();
       virtual Point generateNearbyPoint(const Point& nearThisPoint);
       virtual int dimension();
+      virtual int changeCount();
 
       int width() const;
       int height() const;
@@ -29,7 +49,15 @@ namespace GNG {
     private:
       QMutex *m_dataAccess;
       QImage m_image;
+      HslImage m_hsl;
+      BackgroundModel *m_background;
+      MotionMap *m_motion;
+      int m_changeCount;
+      QList<HslImage> m_pyramid; // levels 1 and up
+      int m_pyramidLevels;
+      int m_level;
       Point pointFromXY(int x, int y);
+      void buildPyramid();
   };
   
 }
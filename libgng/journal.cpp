@@ -0,0 +1,284 @@
+#include "journal.h"
+#include "node.h"
+#include "edge.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <string.h>
+
+using namespace GNG;
+
+// Positions closer than this to the recorded ones aren't worth a record.
+// Well below a pixel for the normalized image coordinates
+static const qreal MinMove = 1e-5;
+
+const quint32 Journal::Version;
+const int Journal::StateInterval;
+
+static void appendVarint(QByteArray *data, quint32 value)
+{
+  while (value >= 0x80) {
+    data->append(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  data->append(char(value));
+}
+
+static void appendFloat(QByteArray *data, float value)
+{
+  data->append((const char*)&value, sizeof(value));
+}
+
+Journal::Journal(const QString& fileName, int dimension, int bufferSize)
+  : m_fileName(fileName),
+    m_dimension(dimension),
+    m_bufferSize(bufferSize),
+    m_step(0),
+    m_positionsSinceState(0),
+    m_recordsWritten(0),
+    m_recordsDropped(0),
+    m_unreportedDrops(0),
+    m_head(0),
+    m_used(0),
+    m_closing(false),
+    m_bytesWritten(0)
+{
+}
+
+Journal::~Journal()
+{
+  close();
+}
+
+bool Journal::open()
+{
+  m_file.setFileName(m_fileName);
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning() << "Could not write journal" << m_fileName << ":" << m_file.errorString();
+    return false;
+  }
+
+  QByteArray header("GNGJRNL", 8);
+  header.append((const char*)&Version, sizeof(Version));
+  quint32 dimension = m_dimension;
+  header.append((const char*)&dimension, sizeof(dimension));
+  m_file.write(header);
+  m_bytesWritten = header.size();
+
+  m_ring = QByteArray(m_bufferSize, 0);
+  m_head = 0;
+  m_used = 0;
+  m_closing = false;
+  start(QThread::LowPriority);
+  return true;
+}
+
+void Journal::close()
+{
+  if (!isRunning()) {
+    return;
+  }
+  m_mutex.lock();
+  m_closing = true;
+  m_dataAvailable.wakeOne();
+  m_mutex.unlock();
+  wait();
+  m_file.close();
+}
+
+void Journal::begin(RecordType type, int step)
+{
+  m_record.clear();
+  m_record.append(char(type));
+  appendVarint(&m_record, step);
+  m_step = step;
+}
+
+// Copies the record into the ring, or drops it if the ring is full
+void Journal::commit()
+{
+  QByteArray lost;
+  if (m_unreportedDrops > 0) {
+    lost.append(char(Lost));
+    appendVarint(&lost, m_step);
+    appendVarint(&lost, m_unreportedDrops);
+  }
+  int size = lost.size() + m_record.size();
+
+  QMutexLocker locker(&m_mutex);
+  if (m_ring.size() - m_used < size) {
+    m_recordsDropped++;
+    m_unreportedDrops++;
+    return;
+  }
+
+  char *ring = m_ring.data();
+  int tail = (m_head + m_used) % m_ring.size();
+  foreach (const QByteArray &part, QList<QByteArray>() << lost << m_record) {
+    int first = qMin(part.size(), m_ring.size() - tail);
+    memcpy(ring + tail, part.constData(), first);
+    memcpy(ring, part.constData() + first, part.size() - first);
+    tail = (tail + part.size()) % m_ring.size();
+  }
+  m_used += size;
+  m_recordsWritten++;
+  m_unreportedDrops = 0;
+  m_dataAvailable.wakeOne();
+}
+
+void Journal::run()
+{
+  forever {
+    m_mutex.lock();
+    while (m_used == 0 && !m_closing) {
+      m_dataAvailable.wait(&m_mutex);
+    }
+    if (m_used == 0) {
+      m_mutex.unlock();
+      break;
+    }
+    // The training thread only ever writes past the used region, so the
+    // used bytes can be written out without holding the lock
+    int head = m_head;
+    int size = qMin(m_used, m_ring.size() - head);
+    const char *ring = m_ring.constData();
+    m_mutex.unlock();
+
+    m_file.write(ring + head, size);
+    m_file.flush();
+
+    m_mutex.lock();
+    m_head = (m_head + size) % m_ring.size();
+    m_used -= size;
+    m_bytesWritten += size;
+    m_mutex.unlock();
+  }
+}
+
+void Journal::nodeInserted(int step, Node* node)
+{
+  begin(NodeInserted, step);
+  appendVarint(&m_record, node->id());
+  Point location = node->location();
+  Point recorded(m_dimension);
+  for (int i=0; i<m_dimension; i++) {
+    float value = location.at(i);
+    appendFloat(&m_record, value);
+    recorded[i] = value;
+  }
+  m_recorded.insert(node->id(), recorded);
+  commit();
+}
+
+void Journal::nodeRemoved(int step, Node* node)
+{
+  begin(NodeRemoved, step);
+  appendVarint(&m_record, node->id());
+  m_recorded.remove(node->id());
+  commit();
+}
+
+void Journal::edgeConnected(int step, Node* a, Node* b)
+{
+  // Not new if the network was loaded before the journal was attached
+  Edge *edge = a->getEdgeTo(b);
+  begin(EdgeConnected, step);
+  appendVarint(&m_record, a->id());
+  appendVarint(&m_record, b->id());
+  appendVarint(&m_record, edge ? edge->age() : 0);
+  appendVarint(&m_record, edge ? edge->totalAge() : 0);
+  commit();
+}
+
+void Journal::edgeRemoved(int step, Node* a, Node* b)
+{
+  begin(EdgeRemoved, step);
+  appendVarint(&m_record, a->id());
+  appendVarint(&m_record, b->id());
+  commit();
+}
+
+void Journal::positions(int step, const QList<Node*>& nodes)
+{
+  if (++m_positionsSinceState >= StateInterval) {
+    state(step, nodes);
+  }
+
+  QByteArray moves;
+  int moved = 0;
+  foreach (Node *node, nodes) {
+    QHash<int, Point>::iterator recorded = m_recorded.find(node->id());
+    if (recorded == m_recorded.end()) {
+      continue;
+    }
+    Point location = node->location();
+    bool changed = false;
+    for (int i=0; i<m_dimension; i++) {
+      if (qAbs(location.at(i) - recorded->at(i)) > MinMove) {
+        changed = true;
+        break;
+      }
+    }
+    if (!changed) {
+      continue;
+    }
+
+    // Track the position the way the replay adds it up, so float rounding
+    // doesn't accumulate
+    appendVarint(&moves, node->id());
+    for (int i=0; i<m_dimension; i++) {
+      float delta = location.at(i) - recorded->at(i);
+      appendFloat(&moves, delta);
+      (*recorded)[i] += delta;
+    }
+    moved++;
+  }
+  if (moved == 0) {
+    return;
+  }
+
+  begin(Positions, step);
+  appendVarint(&m_record, moved);
+  m_record.append(moves);
+  commit();
+}
+
+void Journal::state(int step, const QList<Node*>& nodes)
+{
+  m_positionsSinceState = 0;
+  begin(State, step);
+  appendVarint(&m_record, nodes.size());
+  foreach (Node *node, nodes) {
+    appendVarint(&m_record, node->id());
+    appendFloat(&m_record, node->error());
+    // Each edge once, from the end with the lower id
+    QList<Edge*> edges;
+    foreach (Edge *edge, node->edges()) {
+      if (edge->to()->id() > node->id()) {
+        edges.append(edge);
+      }
+    }
+    appendVarint(&m_record, edges.size());
+    foreach (Edge *edge, edges) {
+      appendVarint(&m_record, edge->to()->id());
+      appendVarint(&m_record, edge->age());
+      appendVarint(&m_record, edge->totalAge());
+    }
+  }
+  commit();
+}
+
+int Journal::recordsWritten() const
+{
+  return m_recordsWritten;
+}
+int Journal::recordsDropped() const
+{
+  return m_recordsDropped;
+}
+qint64 Journal::bytesWritten() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_bytesWritten;
+}
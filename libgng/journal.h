@@ -0,0 +1,107 @@
+#ifndef GNG_JOURNAL_H
+#define GNG_JOURNAL_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QHash>
+#include <QFile>
+#include <QList>
+
+#include "point.h"
+
+namespace GNG {
+  class Node;
+
+  /**
+      Append-only record of everything the GNG does to its topology: node
+      inserts and removals, edge connects and removals, and every so often
+      the position changes of the nodes that moved. Every StateInterval
+      position records the node errors and edge ages follow, so a
+      checkpoint saved from a replay trains and splits into subgraphs
+      like the network that was recorded.
+
+      The training loop only encodes records into a bounded ring buffer. A
+      background thread writes the buffer to disk, so the loop never waits
+      for I/O. When the disk can't keep up and the buffer is full, records
+      are dropped rather than blocking; the journal then notes how many were
+      lost so a replay knows its state is approximate from there on.
+
+      The file starts with the magic "GNGJRNL", the format version and the
+      dimension, each record with a type byte and the step as a varint.
+      Ids and ages are varints, positions and errors 32 bit floats. See
+      JournalReader.
+  */
+  class Journal : public QThread {
+
+    public:
+      enum RecordType {
+        NodeInserted = 1,  /**< id, location */
+        NodeRemoved = 2,   /**< id */
+        EdgeConnected = 3, /**< id, id, age, total age */
+        EdgeRemoved = 4,   /**< id, id */
+        Positions = 5,     /**< count, then id and the change of each coordinate per moved node */
+        Lost = 6,          /**< number of records dropped before this one */
+        State = 7          /**< count, then per node its id, error and edge count, and the
+                                id, age and total age of each edge to a node with a higher id */
+      };
+      static const quint32 Version = 2;
+      static const int StateInterval = 10; /**< Positions records per State record */
+
+      Journal(const QString &fileName, int dimension, int bufferSize = 4 << 20);
+      ~Journal();
+
+      /** Creates the file and starts the writer thread */
+      bool open();
+      /** Writes what is buffered and stops the writer thread */
+      void close();
+
+      void nodeInserted(int step, Node *node);
+      void nodeRemoved(int step, Node *node);
+      void edgeConnected(int step, Node *a, Node *b);
+      void edgeRemoved(int step, Node *a, Node *b);
+      /** Records the change in position of every node that moved since
+          the last call, and every StateInterval calls the state as well */
+      void positions(int step, const QList<Node*> &nodes);
+      /** Records the error of every node and the ages of every edge */
+      void state(int step, const QList<Node*> &nodes);
+
+      int recordsWritten() const;
+      int recordsDropped() const;
+      qint64 bytesWritten() const;
+
+    protected:
+      virtual void run();
+
+    private:
+      void begin(RecordType type, int step);
+      void commit();
+
+      QString m_fileName;
+      QFile m_file;
+      int m_dimension;
+      int m_bufferSize;
+
+      // Training thread only
+      QByteArray m_record;
+      int m_step; // of m_record
+      int m_positionsSinceState;
+      QHash<int, Point> m_recorded; // positions as a replay sees them
+      int m_recordsWritten;
+      int m_recordsDropped;
+      int m_unreportedDrops;
+
+      // Shared with the writer thread
+      mutable QMutex m_mutex;
+      QWaitCondition m_dataAvailable;
+      QByteArray m_ring;
+      int m_head; // next byte to write to disk
+      int m_used;
+      bool m_closing;
+      qint64 m_bytesWritten;
+  };
+
+}
+
+#endif // GNG_JOURNAL_H
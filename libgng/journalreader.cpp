@@ -0,0 +1,330 @@
+#include "journalreader.h"
+#include "journal.h"
+#include "gng.h"
+#include "node.h"
+#include "edge.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+using namespace GNG;
+
+static NodeIdPair idPair(quint32 a, quint32 b)
+{
+  return a < b ? NodeIdPair(a, b) : NodeIdPair(b, a);
+}
+
+JournalReader::JournalReader()
+  : m_data(0),
+    m_size(0),
+    m_start(0),
+    m_offset(0),
+    m_dimension(0),
+    m_step(0),
+    m_recordsRead(0),
+    m_recordsLost(0)
+{
+}
+
+JournalReader::~JournalReader()
+{
+}
+
+bool JournalReader::open(const QString& fileName)
+{
+  m_file.setFileName(fileName);
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Could not read journal" << fileName << ":" << m_file.errorString();
+    return false;
+  }
+  m_size = m_file.size();
+  const int headerSize = 16;
+  if (m_size < headerSize) {
+    qWarning() << fileName << "is not a GNG journal";
+    return false;
+  }
+  m_data = m_file.map(0, m_size);
+  if (!m_data) {
+    qWarning() << "Could not map journal" << fileName << ":" << m_file.errorString();
+    return false;
+  }
+  if (memcmp(m_data, "GNGJRNL", 8) != 0) {
+    qWarning() << fileName << "is not a GNG journal";
+    return false;
+  }
+  quint32 version, dimension;
+  memcpy(&version, m_data + 8, sizeof(version));
+  memcpy(&dimension, m_data + 12, sizeof(dimension));
+  if (version != Journal::Version) {
+    qWarning() << "Journal" << fileName << "is version" << version;
+    return false;
+  }
+
+  m_dimension = dimension;
+  m_start = headerSize;
+  rewind();
+  return true;
+}
+
+void JournalReader::rewind()
+{
+  m_offset = m_start;
+  m_step = 0;
+  m_recordsRead = 0;
+  m_recordsLost = 0;
+  m_nodes.clear();
+  m_errors.clear();
+  m_edges.clear();
+}
+
+bool JournalReader::readVarint(qint64* offset, quint32* value) const
+{
+  *value = 0;
+  for (int shift=0; shift<35; shift+=7) {
+    if (*offset >= m_size) {
+      return false;
+    }
+    uchar byte = m_data[(*offset)++];
+    *value |= quint32(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool JournalReader::readFloat(qint64* offset, float* value) const
+{
+  if (*offset + (qint64)sizeof(float) > m_size) {
+    return false;
+  }
+  memcpy(value, m_data + *offset, sizeof(float));
+  *offset += sizeof(float);
+  return true;
+}
+
+int JournalReader::nextStep() const
+{
+  qint64 offset = m_offset + 1;
+  quint32 step;
+  if (!m_data || !readVarint(&offset, &step)) {
+    return -1;
+  }
+  return step;
+}
+
+bool JournalReader::atEnd() const
+{
+  return nextStep() < 0;
+}
+
+bool JournalReader::advanceTo(int step)
+{
+  forever {
+    int next = nextStep();
+    if (next < 0) {
+      return false;
+    }
+    if (next > step) {
+      return true;
+    }
+    if (!applyRecord()) {
+      // Cut off in the middle of a record
+      m_size = m_offset;
+      return false;
+    }
+  }
+}
+
+// Decodes the whole record before touching the state, so a cut off
+// record is ignored
+bool JournalReader::applyRecord()
+{
+  qint64 offset = m_offset;
+  int type = m_data[offset++];
+  quint32 step, a, b, age, totalAge;
+  if (!readVarint(&offset, &step)) {
+    return false;
+  }
+
+  switch (type) {
+    case Journal::NodeInserted: {
+      Point location(m_dimension);
+      if (!readVarint(&offset, &a)) {
+        return false;
+      }
+      for (int i=0; i<m_dimension; i++) {
+        float value;
+        if (!readFloat(&offset, &value)) {
+          return false;
+        }
+        location[i] = value;
+      }
+      m_nodes.insert(a, location);
+      m_errors.insert(a, 0);
+      break;
+    }
+    case Journal::NodeRemoved:
+      if (!readVarint(&offset, &a)) {
+        return false;
+      }
+      m_nodes.remove(a);
+      m_errors.remove(a);
+      break;
+    case Journal::EdgeConnected: {
+      if (!readVarint(&offset, &a) || !readVarint(&offset, &b)
+          || !readVarint(&offset, &age) || !readVarint(&offset, &totalAge)) {
+        return false;
+      }
+      EdgeAges ages = { int(age), int(totalAge) };
+      m_edges.insert(idPair(a, b), ages);
+      break;
+    }
+    case Journal::EdgeRemoved:
+      if (!readVarint(&offset, &a) || !readVarint(&offset, &b)) {
+        return false;
+      }
+      m_edges.remove(idPair(a, b));
+      break;
+    case Journal::Positions: {
+      quint32 count;
+      if (!readVarint(&offset, &count)) {
+        return false;
+      }
+      // Check the record is complete before moving anything
+      qint64 end = offset;
+      for (quint32 n=0; n<count; n++) {
+        if (!readVarint(&end, &a)) {
+          return false;
+        }
+        end += m_dimension*sizeof(float);
+      }
+      if (end > m_size) {
+        return false;
+      }
+      for (quint32 n=0; n<count; n++) {
+        readVarint(&offset, &a);
+        QHash<int, Point>::iterator node = m_nodes.find(a);
+        for (int i=0; i<m_dimension; i++) {
+          float delta;
+          readFloat(&offset, &delta);
+          if (node != m_nodes.end()) {
+            (*node)[i] += delta;
+          }
+        }
+      }
+      break;
+    }
+    case Journal::State: {
+      quint32 count, edgeCount;
+      if (!readVarint(&offset, &count)) {
+        return false;
+      }
+      // Check the record is complete before changing anything
+      qint64 end = offset;
+      for (quint32 n=0; n<count; n++) {
+        float error;
+        if (!readVarint(&end, &a) || !readFloat(&end, &error) || !readVarint(&end, &edgeCount)) {
+          return false;
+        }
+        for (quint32 e=0; e<edgeCount; e++) {
+          if (!readVarint(&end, &b) || !readVarint(&end, &age) || !readVarint(&end, &totalAge)) {
+            return false;
+          }
+        }
+      }
+      for (quint32 n=0; n<count; n++) {
+        float error;
+        readVarint(&offset, &a);
+        readFloat(&offset, &error);
+        readVarint(&offset, &edgeCount);
+        QHash<int, qreal>::iterator node = m_errors.find(a);
+        if (node != m_errors.end()) {
+          *node = error;
+        }
+        for (quint32 e=0; e<edgeCount; e++) {
+          readVarint(&offset, &b);
+          readVarint(&offset, &age);
+          readVarint(&offset, &totalAge);
+          QHash<NodeIdPair, EdgeAges>::iterator edge = m_edges.find(idPair(a, b));
+          if (edge != m_edges.end()) {
+            edge->age = age;
+            edge->totalAge = totalAge;
+          }
+        }
+      }
+      break;
+    }
+    case Journal::Lost:
+      if (!readVarint(&offset, &a)) {
+        return false;
+      }
+      m_recordsLost += a;
+      break;
+    default:
+      qWarning() << "Unknown journal record" << type << "at offset" << m_offset;
+      return false;
+  }
+
+  m_offset = offset;
+  m_step = step;
+  m_recordsRead++;
+  return true;
+}
+
+void JournalReader::toGng(GrowingNeuralGas* gng) const
+{
+  gng->clearNetwork();
+
+  QHash<int, Node*> nodes;
+  QHash<int, Point>::const_iterator i;
+  for (i = m_nodes.constBegin(); i != m_nodes.constEnd(); ++i) {
+    Node *node = new Node(i.value(), gng->m_dimension, gng->m_min, gng->m_max);
+    node->setError(m_errors.value(i.key()));
+    nodes.insert(i.key(), node);
+    gng->m_nodes.append(node);
+  }
+  QHash<NodeIdPair, EdgeAges>::const_iterator edge;
+  for (edge = m_edges.constBegin(); edge != m_edges.constEnd(); ++edge) {
+    Node *a = nodes.value(edge.key().first);
+    Node *b = nodes.value(edge.key().second);
+    // Either end may be missing if the journal dropped records
+    if (!a || !b) {
+      continue;
+    }
+    gng->connectNodes(a, b);
+    Edge *forward = a->getEdgeTo(b);
+    Edge *backward = b->getEdgeTo(a);
+    forward->setAge(edge->age);
+    backward->setAge(edge->age);
+    forward->setTotalAge(edge->totalAge);
+    backward->setTotalAge(edge->totalAge);
+  }
+  gng->m_currentStep = m_step;
+}
+
+int JournalReader::dimension() const
+{
+  return m_dimension;
+}
+int JournalReader::step() const
+{
+  return m_step;
+}
+int JournalReader::recordsRead() const
+{
+  return m_recordsRead;
+}
+int JournalReader::recordsLost() const
+{
+  return m_recordsLost;
+}
+const QHash<int, Point>& JournalReader::nodes() const
+{
+  return m_nodes;
+}
+const QHash<NodeIdPair, EdgeAges>& JournalReader::edges() const
+{
+  return m_edges;
+}
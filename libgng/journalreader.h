@@ -0,0 +1,82 @@
+#ifndef GNG_JOURNALREADER_H
+#define GNG_JOURNALREADER_H
+
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QString>
+
+#include "point.h"
+
+namespace GNG {
+  class GrowingNeuralGas;
+
+  typedef QPair<int, int> NodeIdPair; /**< Lower id first */
+
+  /** Ages of an edge as of the last record that gave them */
+  struct EdgeAges {
+    int age;
+    int totalAge;
+  };
+
+  /**
+      Rebuilds the network recorded by a Journal, step by step. The file
+      is mapped and read forward only, so getting to a step costs one pass
+      over the records before it. Going back means rewind() and reading
+      forward again.
+
+      A journal that is still being written, or was cut off, simply ends
+      at the last complete record. Node errors and edge ages are only as
+      recent as the last State record, see Journal::StateInterval.
+  */
+  class JournalReader {
+
+    public:
+      JournalReader();
+      ~JournalReader();
+
+      bool open(const QString &fileName);
+      void rewind(); /**< Back to the empty network before the first record */
+
+      /** Applies every record up to and including the given step. Returns
+          false once the end of the journal is reached */
+      bool advanceTo(int step);
+      bool atEnd() const;
+
+      int dimension() const;
+      int step() const; /**< Step of the last applied record */
+      int nextStep() const; /**< Step of the next record, -1 at the end */
+      int recordsRead() const;
+      int recordsLost() const; /**< Records the journal had to drop before the current step */
+
+      const QHash<int, Point>& nodes() const;
+      const QHash<NodeIdPair, EdgeAges>& edges() const;
+
+      /** Replaces the network of the GNG with the current state, for
+          viewing or saving it as a checkpoint */
+      void toGng(GrowingNeuralGas *gng) const;
+
+    private:
+      bool readVarint(qint64 *offset, quint32 *value) const;
+      bool readFloat(qint64 *offset, float *value) const;
+      /** Applies the record at m_offset if complete. */
+      bool applyRecord();
+
+      QFile m_file;
+      const uchar *m_data;
+      qint64 m_size;
+      qint64 m_start; // first record
+      qint64 m_offset; // next record
+      int m_dimension;
+
+      int m_step;
+      int m_recordsRead;
+      int m_recordsLost;
+      QHash<int, Point> m_nodes;
+      QHash<int, qreal> m_errors;
+      QHash<NodeIdPair, EdgeAges> m_edges;
+  };
+
+}
+
+#endif // GNG_JOURNALREADER_H
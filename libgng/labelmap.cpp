@@ -0,0 +1,250 @@
+#include "labelmap.h"
+#include "gng.h"
+#include "node.h"
+
+#include <QHash>
+#include <QColor>
+#include <QtConcurrentMap>
+
+#include <math.h>
+#include <float.h>
+
+using namespace GNG;
+
+// Rows labeled by one task
+static const int BandHeight = 16;
+
+/** A band of rows, labeled on one core with counts of its own */
+struct LabelMap::Band {
+  const LabelMap *map;
+  const HslImage *frame;
+  int *labels;
+  int begin;
+  int end;
+  QVector<int> counts;
+
+  void run() { map->labelBand(*this); }
+};
+
+LabelMap::LabelMap()
+  : m_width(0),
+    m_height(0),
+    m_gridSize(1)
+{
+}
+
+bool LabelMap::label(const QImage& frame, const GrowingNeuralGas& gng)
+{
+  m_converted.convert(frame);
+  return label(m_converted, gng);
+}
+
+bool LabelMap::label(const HslImage& frame, const GrowingNeuralGas& gng)
+{
+  QList<Node*> nodes = gng.nodes();
+  if (frame.isNull() || nodes.isEmpty() || nodes.first()->location().size() != 5) {
+    return false;
+  }
+
+  // Nodes that are newer than the subgraphs get no label
+  QList<Subgraph> subgraphs = gng.subgraphs();
+  QHash<Node*, int> subgraphOf;
+  for (int i=0; i<subgraphs.size(); i++) {
+    foreach (Node *node, subgraphs[i]) {
+      subgraphOf.insert(node, i);
+    }
+  }
+
+  // Sort the nodes into cells, about two to a cell
+  m_gridSize = qBound(1, int(sqrt(nodes.size() / 2.0)), 64);
+  QVector<int> cellOf(nodes.size());
+  m_cellStart.fill(0, m_gridSize*m_gridSize + 1);
+  for (int i=0; i<nodes.size(); i++) {
+    Point location = nodes[i]->location();
+    int cx = qBound(0, int(location[0]*m_gridSize), m_gridSize - 1);
+    int cy = qBound(0, int(location[1]*m_gridSize), m_gridSize - 1);
+    cellOf[i] = cy*m_gridSize + cx;
+    m_cellStart[cellOf[i] + 1]++;
+  }
+  for (int i=0; i<m_gridSize*m_gridSize; i++) {
+    m_cellStart[i+1] += m_cellStart[i];
+  }
+  QVector<int> next = m_cellStart;
+  m_x.resize(nodes.size());
+  m_y.resize(nodes.size());
+  m_hue.resize(nodes.size());
+  m_saturation.resize(nodes.size());
+  m_lightness.resize(nodes.size());
+  m_nodeLabels.resize(nodes.size());
+  for (int i=0; i<nodes.size(); i++) {
+    int index = next[cellOf[i]]++;
+    Point location = nodes[i]->location();
+    m_x[index] = location[0];
+    m_y[index] = location[1];
+    m_hue[index] = location[2];
+    m_saturation[index] = location[3];
+    m_lightness[index] = location[4];
+    m_nodeLabels[index] = subgraphOf.value(nodes[i], -1);
+  }
+
+  // Subgraphs are shown in the average color of their nodes
+  QVector<qreal> hue(subgraphs.size()), saturation(subgraphs.size()), lightness(subgraphs.size());
+  QVector<int> size(subgraphs.size());
+  for (int i=0; i<nodes.size(); i++) {
+    int label = m_nodeLabels[i];
+    if (label >= 0) {
+      hue[label] += m_hue[i];
+      saturation[label] += m_saturation[i];
+      lightness[label] += m_lightness[i];
+      size[label]++;
+    }
+  }
+  m_colors.resize(subgraphs.size());
+  for (int i=0; i<subgraphs.size(); i++) {
+    int count = qMax(size[i], 1);
+    m_colors[i] = QColor::fromHslF(qBound(qreal(0), hue[i]/count, qreal(1)),
+                                   qBound(qreal(0), saturation[i]/count, qreal(1)),
+                                   qBound(qreal(0), lightness[i]/count, qreal(1))).rgb();
+  }
+
+  m_width = frame.width();
+  m_height = frame.height();
+  m_labels.resize(m_width*m_height);
+
+  QList<Band> bands;
+  for (int row=0; row<m_height; row+=BandHeight) {
+    Band band;
+    band.map = this;
+    band.frame = &frame;
+    band.labels = m_labels.data();
+    band.begin = row;
+    band.end = qMin(row + BandHeight, m_height);
+    bands.append(band);
+  }
+  QtConcurrent::blockingMap(bands, &Band::run);
+
+  m_pixelCounts.fill(0, subgraphs.size());
+  foreach (const Band &band, bands) {
+    for (int i=0; i<band.counts.size(); i++) {
+      m_pixelCounts[i] += band.counts[i];
+    }
+  }
+  return true;
+}
+
+void LabelMap::labelBand(Band& band) const
+{
+  band.counts.fill(0, m_colors.size());
+  const float *hue = band.frame->hue();
+  const float *saturation = band.frame->saturation();
+  const float *lightness = band.frame->lightness();
+
+  int winner = -1;
+  for (int y=band.begin; y<band.end; y++) {
+    float normalizedY = float(y) / m_height;
+    for (int x=0; x<m_width; x++) {
+      int pixel = y*m_width + x;
+      winner = nearest(float(x) / m_width, normalizedY,
+                       hue[pixel], saturation[pixel], lightness[pixel], winner);
+      int label = m_nodeLabels[winner];
+      band.labels[pixel] = label;
+      if (label >= 0) {
+        band.counts[label]++;
+      }
+    }
+  }
+}
+
+// Point::distanceTo() for floats: hue wraps around, and the xy distance
+// counts three times in all
+static inline float distance(float dx, float dy, float dh, float ds, float dl)
+{
+  dh = fabsf(dh);
+  dh = qMin(dh, 1 - dh);
+  float xy = dx*dx + dy*dy;
+  return sqrtf(xy + dh*dh + ds*ds + dl*dl) + 2*sqrtf(xy);
+}
+
+int LabelMap::nearest(float x, float y, float hue, float saturation, float lightness, int hint) const
+{
+  float best = FLT_MAX;
+  int winner = 0;
+  if (hint >= 0) {
+    best = distance(m_x[hint] - x, m_y[hint] - y, m_hue[hint] - hue,
+                    m_saturation[hint] - saturation, m_lightness[hint] - lightness);
+    winner = hint;
+  }
+
+  int cx = qBound(0, int(x*m_gridSize), m_gridSize - 1);
+  int cy = qBound(0, int(y*m_gridSize), m_gridSize - 1);
+  float cellSize = 1.0f / m_gridSize;
+  for (int ring=0; ring<m_gridSize; ring++) {
+    // Every node in this ring is more than (ring-1) cells away in x or y
+    if (ring > 1 && 3*(ring-1)*cellSize >= best) {
+      break;
+    }
+    for (int j=cy-ring; j<=cy+ring; j++) {
+      if (j < 0 || j >= m_gridSize) {
+        continue;
+      }
+      // Whole rows at the top and bottom of the ring, the two ends otherwise
+      bool edgeRow = j == cy-ring || j == cy+ring;
+      int step = edgeRow ? 1 : qMax(2*ring, 1);
+      for (int i=cx-ring; i<=cx+ring; i+=step) {
+        if (i < 0 || i >= m_gridSize) {
+          continue;
+        }
+        int cell = j*m_gridSize + i;
+        for (int n=m_cellStart[cell]; n<m_cellStart[cell+1]; n++) {
+          float d = distance(m_x[n] - x, m_y[n] - y, m_hue[n] - hue,
+                             m_saturation[n] - saturation, m_lightness[n] - lightness);
+          if (d < best) {
+            best = d;
+            winner = n;
+          }
+        }
+      }
+    }
+  }
+  return winner;
+}
+
+int LabelMap::width() const
+{
+  return m_width;
+}
+int LabelMap::height() const
+{
+  return m_height;
+}
+
+const int* LabelMap::labels() const
+{
+  return m_labels.constData();
+}
+int LabelMap::label(int x, int y) const
+{
+  return m_labels[y*m_width + x];
+}
+
+int LabelMap::subgraphCount() const
+{
+  return m_colors.size();
+}
+QVector<int> LabelMap::pixelCounts() const
+{
+  return m_pixelCounts;
+}
+
+QImage LabelMap::toImage() const
+{
+  QImage image(m_width, m_height, QImage::Format_RGB32);
+  for (int y=0; y<m_height; y++) {
+    QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+    const int *labels = m_labels.constData() + y*m_width;
+    for (int x=0; x<m_width; x++) {
+      line[x] = labels[x] >= 0 ? m_colors[labels[x]] : qRgb(128, 128, 128);
+    }
+  }
+  return image;
+}
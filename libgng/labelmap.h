@@ -0,0 +1,71 @@
+#ifndef GNG_LABELMAP_H
+#define GNG_LABELMAP_H
+
+#include <QImage>
+#include <QVector>
+#include <QRgb>
+
+#include "hslimage.h"
+
+namespace GNG {
+  class GrowingNeuralGas;
+
+  /**
+      Segments a whole frame with a trained network: every pixel gets the
+      index of the subgraph its nearest node belongs to, by the distance
+      the GNG trains with. Call GrowingNeuralGas::generateSubgraphs() first.
+
+      The node positions are copied when label() is called, so the GNG can
+      go on while the frame is labeled. Nodes are put in a grid by their x
+      and y. As the distance is at least three times the xy distance, a
+      pixel only has to look at the cells around it until the ring being
+      searched is further away than a third of its best distance. Pixels
+      start from their left neighbor's node, which is usually the answer.
+      Bands of rows are labeled in parallel.
+  */
+  class LabelMap {
+
+    public:
+      LabelMap();
+
+      /** Labels every pixel of the frame. False if the GNG isn't over x, y and HSL */
+      bool label(const HslImage &frame, const GrowingNeuralGas &gng);
+      bool label(const QImage &frame, const GrowingNeuralGas &gng);
+
+      int width() const;
+      int height() const;
+      /** Subgraph of every pixel, row by row */
+      const int* labels() const;
+      int label(int x, int y) const;
+
+      int subgraphCount() const;
+      /** Pixels labeled with each subgraph */
+      QVector<int> pixelCounts() const;
+
+      /** Every pixel in the average color of its subgraph */
+      QImage toImage() const;
+
+    private:
+      struct Band;
+      friend struct Band;
+
+      void labelBand(Band &band) const;
+      int nearest(float x, float y, float hue, float saturation, float lightness, int hint) const;
+
+      HslImage m_converted;
+      int m_width;
+      int m_height;
+      QVector<int> m_labels;
+      QVector<int> m_pixelCounts;
+      QVector<QRgb> m_colors;
+
+      // Nodes sorted by grid cell, with their subgraph
+      QVector<float> m_x, m_y, m_hue, m_saturation, m_lightness;
+      QVector<int> m_nodeLabels;
+      QVector<int> m_cellStart; // first node of every cell, and one past the end
+      int m_gridSize;
+  };
+
+}
+
+#endif // GNG_LABELMAP_H
@@ -0,0 +1,155 @@
+#include "metricsserver.h"
+#include "gng.h"
+#include "camerasource.h"
+
+#include <libaibo/aibo.h>
+
+#include <QtNetwork/QTcpSocket>
+#include <QDebug>
+
+using namespace GNG;
+
+// Requests larger than this are not a scrape
+static const int MaxRequestSize = 8192;
+
+static void appendMetric(QString *out, const char *name, const char *type, const char *help, qreal value)
+{
+  *out += QString("# HELP %1 %2\n# TYPE %1 %3\n%1 %4\n")
+    .arg(name).arg(help).arg(type).arg(value, 0, 'g', 12);
+}
+
+MetricsServer::MetricsServer(QObject* parent)
+  : QObject(parent),
+    m_gng(0),
+    m_camera(0),
+    m_aibo(0),
+    m_lastSteps(0),
+    m_lastInsertions(0),
+    m_lastRemovals(0),
+    m_stepsPerSecond(0),
+    m_insertionsPerSecond(0),
+    m_removalsPerSecond(0)
+{
+  connect(&m_server, SIGNAL(newConnection()), SLOT(newConnection()));
+  connect(&m_rateTimer, SIGNAL(timeout()), SLOT(updateRates()));
+  m_rateTimer.start(1000);
+}
+
+MetricsServer::~MetricsServer()
+{
+}
+
+bool MetricsServer::listen(quint16 port)
+{
+  if (!m_server.listen(QHostAddress::LocalHost, port)) {
+    qWarning() << "Could not serve metrics on port" << port << ":" << m_server.errorString();
+    return false;
+  }
+  qDebug() << "Serving metrics on http://localhost:" << port << "/metrics";
+  return true;
+}
+
+void MetricsServer::setGng(GrowingNeuralGas* gng)
+{
+  m_gng = gng;
+  m_lastSteps = gng ? gng->currentStep() : 0;
+  m_lastInsertions = gng ? gng->nodesInserted() : 0;
+  m_lastRemovals = gng ? gng->nodesRemoved() : 0;
+}
+
+void MetricsServer::setCamera(CameraSource* camera)
+{
+  m_camera = camera;
+}
+
+void MetricsServer::setAibo(Aibo* aibo)
+{
+  m_aibo = aibo;
+}
+
+void MetricsServer::updateRates()
+{
+  if (!m_gng) {
+    return;
+  }
+  int steps = m_gng->currentStep();
+  int insertions = m_gng->nodesInserted();
+  int removals = m_gng->nodesRemoved();
+  m_stepsPerSecond = steps - m_lastSteps;
+  m_insertionsPerSecond = insertions - m_lastInsertions;
+  m_removalsPerSecond = removals - m_lastRemovals;
+  m_lastSteps = steps;
+  m_lastInsertions = insertions;
+  m_lastRemovals = removals;
+}
+
+QString MetricsServer::metrics() const
+{
+  QString out;
+  if (m_gng) {
+    appendMetric(&out, "gng_steps_total", "counter", "GNG steps run", m_gng->currentStep());
+    appendMetric(&out, "gng_steps_per_second", "gauge", "GNG steps in the last second", m_stepsPerSecond);
+    appendMetric(&out, "gng_nodes", "gauge", "Nodes in the network", m_gng->nodes().size());
+    appendMetric(&out, "gng_edges", "gauge", "Edges in the network", m_gng->uniqueEdges().size());
+    appendMetric(&out, "gng_average_error", "gauge", "Average node error", m_gng->lastAverageError());
+    appendMetric(&out, "gng_node_insertions_total", "counter", "Nodes inserted", m_gng->nodesInserted());
+    appendMetric(&out, "gng_node_insertions_per_second", "gauge", "Nodes inserted in the last second", m_insertionsPerSecond);
+    appendMetric(&out, "gng_node_removals_total", "counter", "Nodes removed", m_gng->nodesRemoved());
+    appendMetric(&out, "gng_node_removals_per_second", "gauge", "Nodes removed in the last second", m_removalsPerSecond);
+    appendMetric(&out, "gng_edge_removals_total", "counter", "Edges removed", m_gng->edgesRemoved());
+  }
+  if (m_camera) {
+    appendMetric(&out, "gng_camera_frames_total", "counter", "Frames captured", m_camera->capturedFrames());
+    appendMetric(&out, "gng_camera_frames_dropped_total", "counter", "Frames replaced before they were sampled", m_camera->droppedFrames());
+    appendMetric(&out, "gng_camera_frame_age_ms", "gauge", "Average milliseconds from capture to first sample", m_camera->averageFrameAge());
+  }
+  if (m_aibo) {
+    appendMetric(&out, "aibo_camera_frames_total", "counter", "Camera frames received", m_aibo->cameraFramesReceived());
+    appendMetric(&out, "aibo_camera_frames_dropped_total", "counter", "Camera frames replaced before they were decoded", m_aibo->cameraFramesDropped());
+    appendMetric(&out, "aibo_camera_decode_latency_ms", "gauge", "Milliseconds from the last byte of a frame to having it decoded", m_aibo->cameraDecodeLatency());
+    appendMetric(&out, "aibo_control_packets_total", "counter", "Head and walk control packets sent", m_aibo->controlPacketsSent());
+    appendMetric(&out, "aibo_control_latency_ms", "gauge", "Average milliseconds from setting a control to sending it", m_aibo->controlLatency());
+  }
+  return out;
+}
+
+void MetricsServer::newConnection()
+{
+  while (m_server.hasPendingConnections()) {
+    QTcpSocket *socket = m_server.nextPendingConnection();
+    connect(socket, SIGNAL(readyRead()), SLOT(readRequest()));
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+  }
+}
+
+// Answers once the request headers are in. Only GET /metrics is served
+void MetricsServer::readRequest()
+{
+  QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+  if (!socket) {
+    return;
+  }
+  if (socket->bytesAvailable() > MaxRequestSize) {
+    socket->abort();
+    return;
+  }
+  QByteArray request = socket->peek(socket->bytesAvailable());
+  if (!request.contains("\r\n\r\n") && !request.contains("\n\n")) {
+    return;
+  }
+  socket->readAll();
+
+  QByteArray status = "200 OK";
+  QByteArray body;
+  if (request.startsWith("GET /metrics ") || request.startsWith("GET / ")) {
+    body = metrics().toUtf8();
+  } else {
+    status = "404 Not Found";
+  }
+  socket->write("HTTP/1.0 " + status + "\r\n"
+                "Content-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                "Connection: close\r\n\r\n");
+  socket->write(body);
+  socket->disconnectFromHost();
+}
@@ -0,0 +1,65 @@
+#ifndef GNG_METRICSSERVER_H
+#define GNG_METRICSSERVER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QString>
+#include <QtNetwork/QTcpServer>
+
+class Aibo;
+
+namespace GNG {
+  class GrowingNeuralGas;
+  class CameraSource;
+
+  /**
+      Serves the counters and gauges of a GNG, a camera and an Aibo in the
+      Prometheus text format over HTTP on localhost:
+
+        curl http://localhost:9464/metrics
+
+      The server only reads counters the objects keep anyway, on the GUI
+      thread when a scrape comes in, so training pays nothing for it. Per
+      second rates are worked out once a second from the counters.
+  */
+  class MetricsServer : public QObject {
+    Q_OBJECT
+    public:
+      MetricsServer(QObject *parent = 0);
+      ~MetricsServer();
+
+      /** Listens on localhost only */
+      bool listen(quint16 port);
+
+      void setGng(GrowingNeuralGas *gng);
+      void setCamera(CameraSource *camera);
+      void setAibo(Aibo *aibo);
+
+      /** The current metrics in the Prometheus text format */
+      QString metrics() const;
+
+    private slots:
+      void newConnection();
+      void readRequest();
+      void updateRates();
+
+    private:
+      GrowingNeuralGas *m_gng;
+      CameraSource *m_camera;
+      Aibo *m_aibo;
+
+      QTcpServer m_server;
+      QTimer m_rateTimer;
+
+      // Counters as of the last rate update
+      int m_lastSteps;
+      int m_lastInsertions;
+      int m_lastRemovals;
+      qreal m_stepsPerSecond;
+      qreal m_insertionsPerSecond;
+      qreal m_removalsPerSecond;
+  };
+
+}
+
+#endif // GNG_METRICSSERVER_H
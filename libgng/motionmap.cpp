@@ -0,0 +1,117 @@
+#include "motionmap.h"
+#include "hslimage.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace GNG;
+
+MotionMap::MotionMap(int tileSize)
+  : m_tileSize(tileSize),
+    m_threshold(0.03),
+    m_sampleFraction(0.5),
+    m_width(0),
+    m_height(0),
+    m_tilesPerRow(0),
+    m_tileCount(0)
+{
+}
+
+MotionMap::~MotionMap()
+{
+}
+
+bool MotionMap::update(const HslImage& frame)
+{
+  int width = frame.width();
+  int height = frame.height();
+  const float *lightness = frame.lightness();
+
+  if (width != m_width || height != m_height) {
+    m_width = width;
+    m_height = height;
+    m_tilesPerRow = (width + m_tileSize - 1) / m_tileSize;
+    m_tileCount = m_tilesPerRow * ((height + m_tileSize - 1) / m_tileSize);
+    m_difference.resize(m_tileCount);
+    m_previous.resize(width*height);
+    memcpy(m_previous.data(), lightness, width*height*sizeof(float));
+
+    m_changed.resize(m_tileCount);
+    for (int i=0; i<m_tileCount; i++) {
+      m_changed[i] = i;
+    }
+    return m_tileCount > 0;
+  }
+
+  // Sum the differences of every pixel into its tile, one row at a time
+  m_difference.fill(0);
+  float *difference = m_difference.data();
+  float *previous = m_previous.data();
+  for (int y=0; y<height; y++) {
+    float *tiles = difference + (y / m_tileSize) * m_tilesPerRow;
+    const float *current = lightness + y*width;
+    float *last = previous + y*width;
+    for (int tile=0, x=0; x<width; tile++) {
+      int end = qMin(x + m_tileSize, width);
+      float sum = 0;
+      for (; x<end; x++) {
+        sum += fabsf(current[x] - last[x]);
+      }
+      tiles[tile] += sum;
+    }
+    memcpy(last, current, width*sizeof(float));
+  }
+
+  // Tiles on the right and bottom edges may be partial
+  m_changed.resize(0);
+  for (int i=0; i<m_tileCount; i++) {
+    int tileX = (i % m_tilesPerRow) * m_tileSize;
+    int tileY = (i / m_tilesPerRow) * m_tileSize;
+    int pixels = qMin(m_tileSize, width - tileX) * qMin(m_tileSize, height - tileY);
+    if (difference[i] > m_threshold * pixels) {
+      m_changed.append(i);
+    }
+  }
+
+  return !m_changed.isEmpty();
+}
+
+bool MotionMap::changed() const
+{
+  return !m_changed.isEmpty();
+}
+
+int MotionMap::changedTileCount() const
+{
+  return m_changed.size();
+}
+
+int MotionMap::tileCount() const
+{
+  return m_tileCount;
+}
+
+bool MotionMap::pickChangedPixel(int* x, int* y) const
+{
+  if (m_changed.isEmpty() || qrand() >= m_sampleFraction * RAND_MAX) {
+    return false;
+  }
+
+  int tile = m_changed.at(qrand() % m_changed.size());
+  int tileX = (tile % m_tilesPerRow) * m_tileSize;
+  int tileY = (tile / m_tilesPerRow) * m_tileSize;
+  *x = tileX + qrand() % qMin(m_tileSize, m_width - tileX);
+  *y = tileY + qrand() % qMin(m_tileSize, m_height - tileY);
+  return true;
+}
+
+
+// Getters
+int MotionMap::tileSize() const { return m_tileSize; }
+qreal MotionMap::threshold() const { return m_threshold; }
+qreal MotionMap::sampleFraction() const { return m_sampleFraction; }
+
+// Setters
+void MotionMap::setThreshold(qreal threshold) { m_threshold = threshold; }
+void MotionMap::setSampleFraction(qreal fraction) { m_sampleFraction = fraction; }
@@ -0,0 +1,56 @@
+#ifndef GNG_MOTIONMAP_H
+#define GNG_MOTIONMAP_H
+
+#include <QVector>
+
+namespace GNG {
+  class HslImage;
+
+  /**
+      Splits frames into square tiles and marks the tiles whose lightness
+      changed since the previous frame. Sources use it to draw part of
+      their samples from the changed tiles, so the GNG follows whatever
+      moves instead of re-fitting the static parts of the scene.
+  */
+  class MotionMap {
+
+    public:
+      MotionMap(int tileSize = 16);
+      ~MotionMap();
+
+      int tileSize() const;
+      qreal threshold() const;
+      qreal sampleFraction() const;
+
+      void setThreshold(qreal threshold); /**< Mean absolute lightness difference (0-1) above which a tile has changed */
+      void setSampleFraction(qreal fraction); /**< Fraction of samples drawn from changed tiles */
+
+      /** Compares the frame with the previous one. Returns true if any tile
+          changed. The first frame and frames of a new size change everything */
+      bool update(const HslImage &frame);
+
+      bool changed() const;
+      int changedTileCount() const;
+      int tileCount() const;
+
+      /** With a probability of sampleFraction() picks a random pixel within
+          a changed tile. Returns false otherwise or if nothing changed */
+      bool pickChangedPixel(int *x, int *y) const;
+
+    private:
+      int m_tileSize;
+      qreal m_threshold;
+      qreal m_sampleFraction;
+
+      int m_width;
+      int m_height;
+      int m_tilesPerRow;
+      int m_tileCount;
+      QVector<float> m_previous; // lightness of the previous frame
+      QVector<float> m_difference; // summed difference per tile
+      QVector<int> m_changed; // indices of the changed tiles
+  };
+
+}
+
+#endif //GNG_MOTIONMAP_H
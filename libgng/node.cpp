@@ -4,6 +4,7 @@
 #include "edge.h"
 
 #include <QDebug>
+#include <QAtomicInt>
 #include <cstdlib>
 
 using namespace GNG;
@@ -16,7 +17,11 @@ qreal realRand(qreal minimum, qreal maximum) {
   return rand;
 }
 
+// Taken by GNGs training on several threads at once, as in gng-sweep
+static QAtomicInt currentId(0);
+
 Node::Node(const Point &location, int dimension, qreal min, qreal max)
+  : m_id(currentId.fetchAndAddRelaxed(1))
 {
   m_dimension = dimension;
   m_min = min;
@@ -37,6 +42,11 @@ Node::~Node()
 {
 }
 
+int Node::id() const
+{
+  return m_id;
+}
+
 Point Node::location()
 {
   return m_location;
@@ -22,6 +22,7 @@ namespace GNG {
       Node(const Point &location = Point(), int dimension=2, qreal min=0, qreal max=1);
       ~Node();
       
+      int id() const; /**< Unique for the lifetime of the program */
       Point location();
       
       QString toString() const; 
@@ -40,6 +41,7 @@ namespace GNG {
       void moveTowards(const Point &point, qreal learningRate);
 
     private:
+      const int m_id;
       int m_dimension;
       qreal m_min;
       qreal m_max;
@@ -16,6 +16,18 @@ namespace GNG {
       /** If the Generator supports it, generate a point nearby to the given point.
           The default implementation simply calls generatePoint() */
       virtual Point generateNearbyPoint(const Point &nearThisPoint) { return generatePoint(); }
+      /** Number of times the distribution has changed, e.g. new frames that
+          differ from the last one. Sources that never change return 0 */
+      virtual int changeCount() { return 0; }
+      /** Milliseconds on the clock the last point was drawn by, for sources
+          that record or replay one. The GNG times its edges by this clock
+          instead of its own, so a replay removes the same edges as the
+          recorded run. -1 if the source keeps no clock */
+      virtual int clockTime() { return -1; }
+      /** Milliseconds until the next point is due, for sources that hand
+          them out at their own pace. The GNG waits on its timer rather
+          than ask for a point early */
+      virtual int waitTime() { return 0; }
       
       qreal normalize(qreal value, qreal maxValue) { return value/maxValue; }
   };
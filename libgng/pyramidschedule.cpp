@@ -0,0 +1,38 @@
+#include "pyramidschedule.h"
+#include "gng.h"
+#include "imagesource.h"
+#include "eventlog.h"
+
+using namespace GNG;
+
+PyramidSchedule::PyramidSchedule(GrowingNeuralGas* gng, ImageSource* source, int window, qreal refineBelow, QObject* parent)
+  : QObject(parent),
+    m_gng(gng),
+    m_source(source),
+    m_window(qMax(window, 1)),
+    m_refineBelow(refineBelow),
+    m_windowStart(gng->currentStep()),
+    m_insertedAtWindowStart(gng->nodesInserted())
+{
+  m_source->setLevel(m_source->pyramidLevels() - 1);
+  connect(m_gng, SIGNAL(updated()), SLOT(update()));
+}
+
+void PyramidSchedule::update()
+{
+  int steps = m_gng->currentStep() - m_windowStart;
+  if (m_source->level() == 0 || steps < m_window) {
+    return;
+  }
+
+  // A node can go in once every nodeInsertionDelay() steps at most
+  int inserted = m_gng->nodesInserted() - m_insertedAtWindowStart;
+  qreal possible = qreal(steps) / (m_gng->nodeInsertionDelay() + 1);
+  if (inserted < m_refineBelow*possible) {
+    m_source->setLevel(m_source->level() - 1);
+    EventLog::log(EventLog::Source, EventLog::Info, "Pyramid level %1 from step %2 with %3 nodes",
+                  m_source->level(), m_gng->currentStep(), m_gng->nodes().size());
+  }
+  m_windowStart = m_gng->currentStep();
+  m_insertedAtWindowStart = m_gng->nodesInserted();
+}
@@ -0,0 +1,41 @@
+#ifndef GNG_PYRAMIDSCHEDULE_H
+#define GNG_PYRAMIDSCHEDULE_H
+
+#include <QObject>
+
+namespace GNG {
+  class GrowingNeuralGas;
+  class ImageSource;
+
+  /**
+      Trains coarse to fine on an image pyramid, see
+      ImageSource::setPyramidLevels(). The GNG starts on the coarsest
+      level, where the colors are smooth and a few nodes cover the image.
+      Whenever it inserts fewer than refineBelow of the nodes it could
+      have in a window of steps, the network fits the level and the
+      source moves one level finer, down to the image itself.
+
+      The schedule checks the GNG every time it emits updated(), so the
+      window is rounded up to the update interval.
+  */
+  class PyramidSchedule : public QObject {
+    Q_OBJECT
+    public:
+      PyramidSchedule(GrowingNeuralGas *gng, ImageSource *source,
+                      int window = 5000, qreal refineBelow = 0.5, QObject *parent = 0);
+
+    private slots:
+      void update();
+
+    private:
+      GrowingNeuralGas *m_gng;
+      ImageSource *m_source;
+      int m_window;
+      qreal m_refineBelow;
+      int m_windowStart;
+      int m_insertedAtWindowStart;
+  };
+
+}
+
+#endif // GNG_PYRAMIDSCHEDULE_H
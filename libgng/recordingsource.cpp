@@ -0,0 +1,126 @@
+#include "recordingsource.h"
+#include "clock.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+using namespace GNG;
+
+const quint32 RecordingSource::Version;
+const int RecordingSource::HeaderSize;
+
+// Written out in blocks of this size, so the training loop only does
+// a syscall every few hundred samples
+static const int BufferSize = 64 << 10;
+
+RecordingSource::RecordingSource(PointSource* source, const QString& fileName)
+  : m_source(source),
+    m_file(fileName),
+    m_started(0),
+    m_lastTime(0),
+    m_changeCount(0),
+    m_samples(0)
+{
+}
+
+RecordingSource::~RecordingSource()
+{
+  close();
+}
+
+bool RecordingSource::open(quint32 seed, int width, int height)
+{
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    qWarning() << "Could not write samples to" << m_file.fileName() << ":" << m_file.errorString();
+    return false;
+  }
+
+  quint32 header[HeaderSize / 4] = { 0 };
+  memcpy(header, "GNGSMPL", 8);
+  header[2] = Version;
+  header[3] = m_source->dimension();
+  header[4] = seed;
+  header[5] = width;
+  header[6] = height;
+  m_file.write((const char*)header, sizeof(header));
+
+  m_buffer.reserve(BufferSize);
+  m_started = monotonicTime();
+  m_samples = 0;
+  return true;
+}
+
+void RecordingSource::close()
+{
+  if (!m_file.isOpen()) {
+    return;
+  }
+  flush();
+  m_file.close();
+}
+
+void RecordingSource::flush()
+{
+  m_file.write(m_buffer);
+  m_buffer.clear();
+}
+
+void RecordingSource::record(const Point& point)
+{
+  if (!m_file.isOpen()) {
+    return;
+  }
+  qint64 time = monotonicTime() - m_started;
+  m_lastTime = time;
+  qint32 counts[2] = { m_changeCount, 0 };
+  m_buffer.append((const char*)&time, sizeof(time));
+  m_buffer.append((const char*)counts, sizeof(counts));
+  for (int i=0; i<point.size(); i++) {
+    double value = point.at(i);
+    m_buffer.append((const char*)&value, sizeof(value));
+  }
+  m_samples++;
+
+  if (m_buffer.size() >= BufferSize) {
+    flush();
+  }
+}
+
+int RecordingSource::dimension()
+{
+  return m_source->dimension();
+}
+
+Point RecordingSource::generatePoint()
+{
+  Point point = m_source->generatePoint();
+  record(point);
+  return point;
+}
+
+Point RecordingSource::generateNearbyPoint(const Point& nearThisPoint)
+{
+  Point point = m_source->generateNearbyPoint(nearThisPoint);
+  record(point);
+  return point;
+}
+
+int RecordingSource::clockTime()
+{
+  if (!m_file.isOpen() || m_samples == 0) {
+    return -1;
+  }
+  return m_lastTime / 1000000;
+}
+
+int RecordingSource::changeCount()
+{
+  m_changeCount = m_source->changeCount();
+  return m_changeCount;
+}
+
+int RecordingSource::samplesRecorded() const
+{
+  return m_samples;
+}
@@ -0,0 +1,60 @@
+#ifndef GNG_RECORDINGSOURCE_H
+#define GNG_RECORDINGSOURCE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+#include "pointsource.h"
+
+namespace GNG {
+
+  /**
+      Passes the points of another source through to the GNG and writes
+      each one to a file, along with when it was drawn and the source's
+      changeCount(). Together with the random seed in the header, a
+      ReplaySource can then feed a GNG exactly what the live run saw, on a
+      machine without the camera or the robot.
+
+      The file is a 32 byte header ("GNGSMPL", version, dimension, seed,
+      frame width and height) followed by fixed size samples: nanoseconds
+      since open(), the change count, and the point as doubles.
+  */
+  class RecordingSource : public PointSource {
+
+    public:
+      static const quint32 Version = 1;
+      static const int HeaderSize = 32;
+
+      RecordingSource(PointSource *source, const QString &fileName);
+      ~RecordingSource();
+
+      /** Seed is the one given to qsrand() for the run. The frame size
+          lets a replay size its view like the source's */
+      bool open(quint32 seed, int width = 0, int height = 0);
+      void close();
+
+      virtual int dimension();
+      virtual Point generatePoint();
+      virtual Point generateNearbyPoint(const Point &nearThisPoint);
+      virtual int changeCount();
+      virtual int clockTime();
+
+      int samplesRecorded() const;
+
+    private:
+      void record(const Point &point);
+      void flush();
+
+      PointSource *m_source;
+      QFile m_file;
+      QByteArray m_buffer;
+      qint64 m_started;
+      qint64 m_lastTime; // of the last sample, nanoseconds since open()
+      int m_changeCount; // as last returned to the GNG
+      int m_samples;
+  };
+
+}
+
+#endif // GNG_RECORDINGSOURCE_H
@@ -0,0 +1,181 @@
+#include "replaysource.h"
+#include "recordingsource.h"
+#include "clock.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+using namespace GNG;
+
+// Sample layout, see RecordingSource
+static const int TimeOffset = 0;
+static const int ChangeCountOffset = 8;
+static const int PointOffset = 16;
+
+ReplaySource::ReplaySource(const QString& fileName)
+  : m_file(fileName),
+    m_data(0),
+    m_dimension(0),
+    m_sampleSize(0),
+    m_sampleCount(0),
+    m_seed(0),
+    m_width(0),
+    m_height(0),
+    m_next(0),
+    m_loops(0),
+    m_changeCountOffset(0),
+    m_realTime(false),
+    m_started(0),
+    m_lastTime(0),
+    m_loopTime(0)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+}
+
+bool ReplaySource::open()
+{
+  if (!m_file.open(QIODevice::ReadOnly)) {
+    qWarning() << "Could not read samples from" << m_file.fileName() << ":" << m_file.errorString();
+    return false;
+  }
+  qint64 size = m_file.size();
+  if (size < RecordingSource::HeaderSize) {
+    qWarning() << m_file.fileName() << "is not a sample recording";
+    return false;
+  }
+  m_data = m_file.map(0, size);
+  if (!m_data) {
+    qWarning() << "Could not map" << m_file.fileName() << ":" << m_file.errorString();
+    return false;
+  }
+
+  quint32 header[RecordingSource::HeaderSize / 4];
+  memcpy(header, m_data, sizeof(header));
+  if (memcmp(header, "GNGSMPL", 8) != 0 || header[2] != RecordingSource::Version) {
+    qWarning() << m_file.fileName() << "is not a version" << RecordingSource::Version << "sample recording";
+    return false;
+  }
+  m_dimension = header[3];
+  m_seed = header[4];
+  m_width = header[5];
+  m_height = header[6];
+
+  // A recording that was cut off ends at its last complete sample
+  m_sampleSize = PointOffset + m_dimension*sizeof(double);
+  m_sampleCount = (size - RecordingSource::HeaderSize) / m_sampleSize;
+  if (m_sampleCount == 0) {
+    qWarning() << m_file.fileName() << "has no samples";
+    return false;
+  }
+
+  m_next = 0;
+  m_loops = 0;
+  m_changeCountOffset = 0;
+  m_started = monotonicTime();
+  m_lastTime = 0;
+  m_loopTime = 0;
+  return true;
+}
+
+const uchar* ReplaySource::sample(int index) const
+{
+  return m_data + RecordingSource::HeaderSize + (qint64)index*m_sampleSize;
+}
+
+Point ReplaySource::generatePoint()
+{
+  if (m_next == m_sampleCount) {
+    qint32 lastChangeCount;
+    memcpy(&lastChangeCount, sample(m_sampleCount - 1) + ChangeCountOffset, sizeof(lastChangeCount));
+    m_changeCountOffset += lastChangeCount + 1;
+    // The clock keeps going forward across loops
+    qint64 lastTime;
+    memcpy(&lastTime, sample(m_sampleCount - 1) + TimeOffset, sizeof(lastTime));
+    m_loopTime += lastTime;
+    m_next = 0;
+    m_loops++;
+    m_started = monotonicTime();
+    if (m_loops == 1) {
+      qDebug() << "Replayed all" << m_sampleCount << "samples, starting over";
+    }
+  }
+
+  const uchar *data = sample(m_next);
+  m_next++;
+  memcpy(&m_lastTime, data + TimeOffset, sizeof(m_lastTime));
+
+  Point point(m_dimension);
+  const double *values = (const double*)(data + PointOffset);
+  for (int i=0; i<m_dimension; i++) {
+    point[i] = values[i];
+  }
+  return point;
+}
+
+Point ReplaySource::generateNearbyPoint(const Point& nearThisPoint)
+{
+  // Already recorded near the right point
+  Q_UNUSED(nearThisPoint);
+  return generatePoint();
+}
+
+int ReplaySource::changeCount()
+{
+  // The count the recording returned right before drawing the next point
+  qint32 count;
+  memcpy(&count, sample(m_next % m_sampleCount) + ChangeCountOffset, sizeof(count));
+  return m_changeCountOffset + count;
+}
+
+int ReplaySource::clockTime()
+{
+  return (m_loopTime + m_lastTime) / 1000000;
+}
+
+int ReplaySource::waitTime()
+{
+  // The first point of the next loop is due right away, generatePoint()
+  // restarts the clock for it
+  if (!m_realTime || m_next == m_sampleCount) {
+    return 0;
+  }
+  qint64 time;
+  memcpy(&time, sample(m_next) + TimeOffset, sizeof(time));
+  qint64 wait = m_started + time - monotonicTime();
+  return wait > 0 ? (wait + 999999) / 1000000 : 0;
+}
+
+int ReplaySource::dimension()
+{
+  return m_dimension;
+}
+
+void ReplaySource::setRealTime(bool realTime)
+{
+  m_realTime = realTime;
+}
+
+quint32 ReplaySource::seed() const
+{
+  return m_seed;
+}
+int ReplaySource::width() const
+{
+  return m_width;
+}
+int ReplaySource::height() const
+{
+  return m_height;
+}
+int ReplaySource::sampleCount() const
+{
+  return m_sampleCount;
+}
+int ReplaySource::loops() const
+{
+  return m_loops;
+}
@@ -0,0 +1,69 @@
+#ifndef GNG_REPLAYSOURCE_H
+#define GNG_REPLAYSOURCE_H
+
+#include <QFile>
+#include <QString>
+
+#include "pointsource.h"
+
+namespace GNG {
+
+  /**
+      Feeds the points written by a RecordingSource back to a GNG, in the
+      same order, with the same changeCount() and on the recorded
+      clockTime(), which the GNG times its edges by. Seed the random number
+      generator with seed() before creating the GNG and the run repeats
+      the recorded one step for step.
+
+      By default points are handed out as fast as they are asked for. In
+      real time mode waitTime() holds the GNG back until as long after the
+      start as each point was drawn in the recording. At the end the
+      recording starts over.
+  */
+  class ReplaySource : public PointSource {
+
+    public:
+      ReplaySource(const QString &fileName);
+      ~ReplaySource();
+
+      bool open();
+
+      quint32 seed() const;
+      int width() const; /**< Of the recorded frames, 0 if unknown */
+      int height() const;
+      int sampleCount() const;
+      int loops() const; /**< Times the recording started over */
+
+      void setRealTime(bool realTime);
+
+      virtual int dimension();
+      virtual Point generatePoint();
+      virtual Point generateNearbyPoint(const Point &nearThisPoint);
+      virtual int changeCount();
+      virtual int clockTime();
+      virtual int waitTime();
+
+    private:
+      const uchar* sample(int index) const;
+
+      QFile m_file;
+      const uchar *m_data;
+      int m_dimension;
+      int m_sampleSize;
+      int m_sampleCount;
+      quint32 m_seed;
+      int m_width;
+      int m_height;
+
+      int m_next;
+      int m_loops;
+      int m_changeCountOffset; // keeps changeCount() growing across loops
+      bool m_realTime;
+      qint64 m_started;
+      qint64 m_lastTime; // recorded time of the last point, nanoseconds
+      qint64 m_loopTime; // recorded time of all loops before this one
+  };
+
+}
+
+#endif // GNG_REPLAYSOURCE_H
@@ -0,0 +1,31 @@
+#include "sharedimagesource.h"
+
+using namespace GNG;
+
+SharedImageSource::SharedImageSource(const HslImage& frame, quint32 seed)
+  : SyntheticSource(5, seed),
+    m_frame(frame)
+{
+}
+
+void SharedImageSource::fillBatch(QVector<Point>& batch)
+{
+  const float *hue = m_frame.hue();
+  const float *saturation = m_frame.saturation();
+  const float *lightness = m_frame.lightness();
+  int width = m_frame.width();
+  int height = m_frame.height();
+
+  for (int i=0; i<batch.size(); i++) {
+    int x = below(width);
+    int y = below(height);
+    int pixel = y*width + x;
+    Point point(m_dimension);
+    point[0] = normalize(x, width);
+    point[1] = normalize(y, height);
+    point[2] = hue[pixel];
+    point[3] = saturation[pixel];
+    point[4] = lightness[pixel];
+    batch[i] = point;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef GNG_SHAREDIMAGESOURCE_H
+#define GNG_SHAREDIMAGESOURCE_H
+
+#include "syntheticsource.h"
+#include "hslimage.h"
+
+namespace GNG {
+
+  /**
+      Samples pixels from a frame converted once, for many GNGs training
+      on the same image in parallel. ImageSource locks a mutex for every
+      point and draws with qrand(); this source only reads the HSL planes,
+      which all copies of the frame share, and has a random number
+      generator of its own. Points are x, y, hue, saturation and
+      lightness, as from an ImageSource without a background model.
+  */
+  class SharedImageSource : public SyntheticSource {
+
+    public:
+      SharedImageSource(const HslImage &frame, quint32 seed = 1);
+
+    protected:
+      virtual void fillBatch(QVector<Point> &batch);
+
+    private:
+      HslImage m_frame;
+  };
+
+}
+
+#endif // GNG_SHAREDIMAGESOURCE_H
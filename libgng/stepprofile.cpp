@@ -0,0 +1,130 @@
+#include "stepprofile.h"
+
+#include <string.h>
+
+using namespace GNG;
+
+const int StepProfile::SubBuckets;
+const int StepProfile::BucketCount;
+
+StepProfile::StepProfile()
+{
+  clear();
+}
+
+bool StepProfile::compiledIn()
+{
+#ifdef GNG_PROFILING
+  return true;
+#else
+  return false;
+#endif
+}
+
+QString StepProfile::phaseName(Phase phase)
+{
+  switch (phase) {
+    case Sample: return "sample";
+    case WinnerSearch: return "winner search";
+    case EdgeAging: return "edge aging";
+    case Adaptation: return "adaptation";
+    case History: return "edge history";
+    case OldEdgeRemoval: return "old edge removal";
+    case Insertion: return "insertion";
+    case ErrorDecay: return "error decay";
+    default: return QString();
+  }
+}
+
+QString StepProfile::counterName(Counter counter)
+{
+  switch (counter) {
+    case NodesInserted: return "nodes inserted";
+    case NodesRemoved: return "nodes removed";
+    case EdgesConnected: return "edges connected";
+    case EdgesRemoved: return "edges removed";
+    default: return QString();
+  }
+}
+
+void StepProfile::clear()
+{
+  memset(m_buckets, 0, sizeof(m_buckets));
+  memset(m_samples, 0, sizeof(m_samples));
+  memset(m_total, 0, sizeof(m_total));
+  memset(m_counters, 0, sizeof(m_counters));
+}
+
+// Largest value that falls in the bucket
+qint64 StepProfile::bucketLimit(int bucket)
+{
+  if (bucket < SubBuckets) {
+    return bucket;
+  }
+  int exponent = bucket/SubBuckets + 2;
+  int fraction = bucket % SubBuckets;
+  return (qint64(SubBuckets + fraction + 1) << (exponent - 3)) - 1;
+}
+
+qint64 StepProfile::samples(Phase phase) const
+{
+  return m_samples[phase];
+}
+
+qint64 StepProfile::total(Phase phase) const
+{
+  return m_total[phase];
+}
+
+qreal StepProfile::mean(Phase phase) const
+{
+  if (m_samples[phase] == 0) {
+    return 0;
+  }
+  return qreal(m_total[phase]) / m_samples[phase];
+}
+
+qint64 StepProfile::percentile(Phase phase, qreal fraction) const
+{
+  qint64 wanted = qint64(fraction*m_samples[phase] + 0.5);
+  qint64 seen = 0;
+  for (int i=0; i<BucketCount; i++) {
+    seen += m_buckets[phase][i];
+    if (seen >= wanted && seen > 0) {
+      return bucketLimit(i);
+    }
+  }
+  return 0;
+}
+
+qint64 StepProfile::counter(Counter counter) const
+{
+  return m_counters[counter];
+}
+
+QString StepProfile::report() const
+{
+  qint64 stepTotal = 0;
+  for (int i=0; i<PhaseCount; i++) {
+    stepTotal += m_total[i];
+  }
+
+  QString report = QString("%1 %2 %3 %4 %5\n")
+    .arg("phase", -18).arg("mean us", 10).arg("p50 us", 10).arg("p99 us", 10).arg("share", 7);
+  for (int i=0; i<PhaseCount; i++) {
+    Phase phase = Phase(i);
+    report += QString("%1 %2 %3 %4 %5%\n")
+      .arg(phaseName(phase), -18)
+      .arg(mean(phase) / 1000, 10, 'f', 2)
+      .arg(percentile(phase, 0.5) / 1000.0, 10, 'f', 2)
+      .arg(percentile(phase, 0.99) / 1000.0, 10, 'f', 2)
+      .arg(stepTotal > 0 ? 100.0*m_total[i]/stepTotal : 0, 6, 'f', 1);
+  }
+  report += QString("%1 steps, %2 us per step\n")
+    .arg(m_samples[Sample])
+    .arg(m_samples[Sample] > 0 ? stepTotal / 1000.0 / m_samples[Sample] : 0, 0, 'f', 2);
+  for (int i=0; i<CounterCount; i++) {
+    report += QString("%1 %2\n").arg(counterName(Counter(i)), -18).arg(m_counters[i]);
+  }
+  return report;
+}
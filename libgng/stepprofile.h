@@ -0,0 +1,123 @@
+#ifndef GNG_STEPPROFILE_H
+#define GNG_STEPPROFILE_H
+
+#include <QString>
+
+#include "clock.h"
+
+namespace GNG {
+
+  /**
+      Where the time of a GNG step goes: a latency histogram per phase of
+      GrowingNeuralGas::runSingleStep() and a few event counters.
+
+      Histogram buckets are powers of two split into eight, so percentiles
+      are within 12.5% of the true value whatever the range.
+
+      The GNG only fills a profile when built with GNG_PROFILING (cmake
+      -DGNG_PROFILING=ON). Otherwise the GNG_PROFILE_* macros expand to
+      nothing and the step has no profiling code at all.
+  */
+  class StepProfile {
+
+    public:
+      enum Phase {
+        Sample,
+        WinnerSearch,
+        EdgeAging,
+        Adaptation,
+        History,
+        OldEdgeRemoval,
+        Insertion,
+        ErrorDecay,
+        PhaseCount
+      };
+      enum Counter {
+        NodesInserted,
+        NodesRemoved,
+        EdgesConnected,
+        EdgesRemoved,
+        CounterCount
+      };
+
+      StepProfile();
+
+      /** Whether the GNG was built with GNG_PROFILING */
+      static bool compiledIn();
+      static QString phaseName(Phase phase);
+      static QString counterName(Counter counter);
+
+      void record(Phase phase, qint64 nanoseconds)
+      {
+        m_buckets[phase][bucket(nanoseconds)]++;
+        m_samples[phase]++;
+        m_total[phase] += nanoseconds;
+      }
+      void count(Counter counter) { m_counters[counter]++; }
+      void clear();
+
+      qint64 samples(Phase phase) const;
+      qint64 total(Phase phase) const; /**< Nanoseconds */
+      qreal mean(Phase phase) const; /**< Nanoseconds */
+      /** Nanoseconds that the given fraction (0.5, 0.99, ...) of the samples stay under */
+      qint64 percentile(Phase phase, qreal fraction) const;
+      qint64 counter(Counter counter) const;
+
+      /** A table of every phase and counter */
+      QString report() const;
+
+    private:
+      static const int SubBuckets = 8;
+      static const int BucketCount = 64*SubBuckets;
+
+      static int bucket(qint64 nanoseconds)
+      {
+        if (nanoseconds < SubBuckets) {
+          return qMax(nanoseconds, qint64(0));
+        }
+        int exponent = 63 - __builtin_clzll(nanoseconds);
+        int fraction = (nanoseconds >> (exponent - 3)) & (SubBuckets - 1);
+        return (exponent - 2)*SubBuckets + fraction;
+      }
+      static qint64 bucketLimit(int bucket);
+
+      qint64 m_buckets[PhaseCount][BucketCount];
+      qint64 m_samples[PhaseCount];
+      qint64 m_total[PhaseCount];
+      qint64 m_counters[CounterCount];
+  };
+
+  /** Times consecutive phases with one clock read per phase */
+  class PhaseClock {
+    public:
+      PhaseClock(StepProfile *profile)
+        : m_profile(profile),
+          m_start(profile ? monotonicTime() : 0)
+      {
+      }
+      void endPhase(StepProfile::Phase phase)
+      {
+        if (m_profile) {
+          qint64 now = monotonicTime();
+          m_profile->record(phase, now - m_start);
+          m_start = now;
+        }
+      }
+    private:
+      StepProfile *m_profile;
+      qint64 m_start;
+  };
+
+}
+
+#ifdef GNG_PROFILING
+#define GNG_PROFILE_BEGIN(profile) GNG::PhaseClock gngPhaseClock(profile)
+#define GNG_PROFILE_PHASE(phase) gngPhaseClock.endPhase(GNG::StepProfile::phase)
+#define GNG_PROFILE_COUNT(profile, counter) do { if (profile) (profile)->count(GNG::StepProfile::counter); } while (0)
+#else
+#define GNG_PROFILE_BEGIN(profile) do {} while (0)
+#define GNG_PROFILE_PHASE(phase) do {} while (0)
+#define GNG_PROFILE_COUNT(profile, counter) do {} while (0)
+#endif
+
+#endif // GNG_STEPPROFILE_H
@@ -0,0 +1,204 @@
+#include "syntheticsource.h"
+
+#include <math.h>
+
+using namespace GNG;
+
+const int SyntheticSource::BatchSize;
+
+SyntheticSource::SyntheticSource(int dimension, quint32 seed)
+  : m_dimension(dimension),
+    m_changeCount(0),
+    // xorshift must not start from 0
+    m_state(quint64(seed) * Q_UINT64_C(0x9E3779B97F4A7C15) + 1),
+    m_hasGaussian(false),
+    m_nextGaussian(0),
+    m_batch(BatchSize),
+    m_next(BatchSize)
+{
+}
+
+int SyntheticSource::dimension()
+{
+  return m_dimension;
+}
+
+int SyntheticSource::changeCount()
+{
+  return m_changeCount;
+}
+
+Point SyntheticSource::generatePoint()
+{
+  if (m_next == m_batch.size()) {
+    fillBatch(m_batch);
+    m_next = 0;
+  }
+  return m_batch[m_next++];
+}
+
+// xorshift64*, fast and good enough for sampling
+qreal SyntheticSource::uniform()
+{
+  m_state ^= m_state >> 12;
+  m_state ^= m_state << 25;
+  m_state ^= m_state >> 27;
+  quint64 value = m_state * Q_UINT64_C(2685821657736338717);
+  return (value >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Marsaglia's polar method, which gives two at a time
+qreal SyntheticSource::gaussian()
+{
+  if (m_hasGaussian) {
+    m_hasGaussian = false;
+    return m_nextGaussian;
+  }
+  qreal u, v, s;
+  do {
+    u = 2*uniform() - 1;
+    v = 2*uniform() - 1;
+    s = u*u + v*v;
+  } while (s >= 1 || s == 0);
+  qreal factor = sqrt(-2*log(s)/s);
+  m_nextGaussian = v*factor;
+  m_hasGaussian = true;
+  return u*factor;
+}
+
+int SyntheticSource::below(int limit)
+{
+  return qMin(int(uniform()*limit), limit - 1);
+}
+
+
+UniformSource::UniformSource(int dimension, quint32 seed)
+  : SyntheticSource(dimension, seed)
+{
+}
+
+void UniformSource::fillBatch(QVector<Point>& batch)
+{
+  for (int i=0; i<batch.size(); i++) {
+    Point point(m_dimension);
+    for (int j=0; j<m_dimension; j++) {
+      point[j] = uniform();
+    }
+    batch[i] = point;
+  }
+}
+
+
+GaussianMixtureSource::GaussianMixtureSource(int dimension, int clusters, qreal deviation, quint32 seed)
+  : SyntheticSource(dimension, seed),
+    m_deviation(deviation)
+{
+  for (int i=0; i<qMax(clusters, 1); i++) {
+    Point center(m_dimension);
+    for (int j=0; j<m_dimension; j++) {
+      center[j] = 0.1 + 0.8*uniform();
+    }
+    m_centers.append(center);
+  }
+}
+
+QVector<Point> GaussianMixtureSource::centers() const
+{
+  return m_centers;
+}
+
+void GaussianMixtureSource::fillBatch(QVector<Point>& batch)
+{
+  for (int i=0; i<batch.size(); i++) {
+    const Point &center = m_centers[below(m_centers.size())];
+    Point point(m_dimension);
+    for (int j=0; j<m_dimension; j++) {
+      point[j] = qBound(qreal(0), center[j] + m_deviation*gaussian(), qreal(1));
+    }
+    batch[i] = point;
+  }
+}
+
+
+BlobSource::BlobSource(int dimension, int blobs, qreal colorNoise, quint32 seed)
+  : SyntheticSource(qMax(dimension, 2), seed),
+    m_totalArea(0),
+    m_colorNoise(colorNoise)
+{
+  for (int i=0; i<qMax(blobs, 1); i++) {
+    Blob blob;
+    blob.radius = 0.03 + 0.07*uniform();
+    blob.x = blob.radius + (1 - 2*blob.radius)*uniform();
+    blob.y = blob.radius + (1 - 2*blob.radius)*uniform();
+    for (int j=2; j<m_dimension; j++) {
+      blob.color.append(uniform());
+    }
+    // Sampled like pixels, so bigger blobs get more points
+    blob.area = blob.radius*blob.radius;
+    m_totalArea += blob.area;
+    m_blobs.append(blob);
+  }
+}
+
+void BlobSource::fillBatch(QVector<Point>& batch)
+{
+  for (int i=0; i<batch.size(); i++) {
+    qreal pick = uniform()*m_totalArea;
+    int index = 0;
+    while (index < m_blobs.size() - 1 && pick >= m_blobs[index].area) {
+      pick -= m_blobs[index].area;
+      index++;
+    }
+    const Blob &blob = m_blobs[index];
+
+    qreal distance = blob.radius*sqrt(uniform());
+    qreal angle = 2*M_PI*uniform();
+    Point point(m_dimension);
+    point[0] = blob.x + distance*cos(angle);
+    point[1] = blob.y + distance*sin(angle);
+    for (int j=2; j<m_dimension; j++) {
+      point[j] = qBound(qreal(0), blob.color[j-2] + m_colorNoise*gaussian(), qreal(1));
+    }
+    batch[i] = point;
+  }
+}
+
+
+DriftingMixtureSource::DriftingMixtureSource(int dimension, int clusters, qreal speed,
+                                             qreal deviation, quint32 seed)
+  : GaussianMixtureSource(dimension, clusters, deviation, seed)
+{
+  // A random direction for every center
+  for (int i=0; i<m_centers.size(); i++) {
+    Point velocity(m_dimension);
+    qreal length = 0;
+    for (int j=0; j<m_dimension; j++) {
+      velocity[j] = gaussian();
+      length += velocity[j]*velocity[j];
+    }
+    length = sqrt(length);
+    for (int j=0; j<m_dimension; j++) {
+      velocity[j] *= length > 0 ? speed/length : 0;
+    }
+    m_velocities.append(velocity);
+  }
+}
+
+void DriftingMixtureSource::fillBatch(QVector<Point>& batch)
+{
+  GaussianMixtureSource::fillBatch(batch);
+
+  // Move on by a batch worth of points, keeping the clusters inside
+  for (int i=0; i<m_centers.size(); i++) {
+    Point &center = m_centers[i];
+    Point &velocity = m_velocities[i];
+    for (int j=0; j<m_dimension; j++) {
+      center[j] += batch.size()*velocity[j];
+      if (center[j] < 0.1 || center[j] > 0.9) {
+        velocity[j] = -velocity[j];
+        center[j] = qBound(qreal(0.1), center[j], qreal(0.9));
+      }
+    }
+  }
+  m_changeCount++;
+}
@@ -0,0 +1,130 @@
+#ifndef GNG_SYNTHETICSOURCE_H
+#define GNG_SYNTHETICSOURCE_H
+
+#include <QVector>
+
+#include "pointsource.h"
+
+namespace GNG {
+
+  /**
+      Base of the generated distributions, for stressing the GNG at a
+      scale and in dimensions no image gives. Every source has a random
+      number generator of its own, so the same seed gives the same points
+      whatever else draws random numbers. The GNG places its first nodes
+      with qrand(), seed that as well to repeat a run exactly.
+
+      Points are generated a batch at a time by fillBatch() and handed out
+      one by one. All coordinates are in [0, 1]. The GNG's distance takes
+      the third coordinate for a hue, so sources it trains on need a
+      dimension of at least 3.
+  */
+  class SyntheticSource : public PointSource {
+
+    public:
+      SyntheticSource(int dimension, quint32 seed);
+
+      virtual int dimension();
+      virtual Point generatePoint();
+      virtual int changeCount();
+
+    protected:
+      static const int BatchSize = 256;
+
+      /** Replaces every point in batch with a new one */
+      virtual void fillBatch(QVector<Point> &batch) = 0;
+
+      qreal uniform(); /**< In [0, 1) */
+      qreal gaussian(); /**< Mean 0, deviation 1 */
+      int below(int limit); /**< In [0, limit) */
+
+      int m_dimension;
+      int m_changeCount;
+
+    private:
+      quint64 m_state;
+      bool m_hasGaussian;
+      qreal m_nextGaussian;
+
+      QVector<Point> m_batch;
+      int m_next;
+  };
+
+  /** Evenly spread over the unit hypercube */
+  class UniformSource : public SyntheticSource {
+
+    public:
+      UniformSource(int dimension, quint32 seed = 1);
+
+    protected:
+      virtual void fillBatch(QVector<Point> &batch);
+  };
+
+  /**
+      Equally likely Gaussian clusters with the same deviation in every
+      direction, centered at random in [0.1, 0.9]. Points that fall
+      outside the hypercube are clamped to it.
+  */
+  class GaussianMixtureSource : public SyntheticSource {
+
+    public:
+      GaussianMixtureSource(int dimension, int clusters, qreal deviation = 0.05, quint32 seed = 1);
+
+      QVector<Point> centers() const;
+
+    protected:
+      virtual void fillBatch(QVector<Point> &batch);
+
+      QVector<Point> m_centers;
+      qreal m_deviation;
+  };
+
+  /**
+      Round blobs of solid color on an empty background, like a
+      segmented image. The first two coordinates are x and y, uniform
+      over a blob's disc. The others are its color, HSL for dimension 5,
+      with a little noise. Needs a dimension of at least 2.
+  */
+  class BlobSource : public SyntheticSource {
+
+    public:
+      BlobSource(int dimension, int blobs, qreal colorNoise = 0.01, quint32 seed = 1);
+
+    protected:
+      virtual void fillBatch(QVector<Point> &batch);
+
+    private:
+      struct Blob {
+        qreal x;
+        qreal y;
+        qreal radius;
+        QVector<qreal> color;
+        qreal area;
+      };
+      QVector<Blob> m_blobs;
+      qreal m_totalArea;
+      qreal m_colorNoise;
+  };
+
+  /**
+      A Gaussian mixture whose centers keep moving in straight lines,
+      bouncing off the sides of the hypercube, for tests on input that
+      changes while the GNG learns it. Centers move by speed per point
+      drawn, and changeCount() goes up with every batch.
+  */
+  class DriftingMixtureSource : public GaussianMixtureSource {
+
+    public:
+      DriftingMixtureSource(int dimension, int clusters, qreal speed = 1e-5,
+                            qreal deviation = 0.05, quint32 seed = 1);
+
+    protected:
+      virtual void fillBatch(QVector<Point> &batch);
+
+    private:
+      QVector<Point> m_velocities;
+  };
+
+}
+
+#endif // GNG_SYNTHETICSOURCE_H
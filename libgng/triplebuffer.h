@@ -0,0 +1,69 @@
+#ifndef GNG_TRIPLEBUFFER_H
+#define GNG_TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+namespace GNG {
+
+  /**
+      Lock free hand-off of the newest value from one producer thread to
+      one consumer thread. The producer fills back() and publishes it, the
+      consumer calls update() and reads front(). The third slot holds the
+      newest published value in between, so neither side ever waits and the
+      newest value always wins: a published value that is replaced before
+      the consumer picks it up is dropped.
+  */
+  template <typename T>
+  class TripleBuffer {
+
+    public:
+      TripleBuffer()
+        : m_front(0),
+          m_back(2),
+          m_middle(1)
+      {
+      }
+
+      /** The slot being filled. Only the producer may touch it */
+      T& back() { return m_slots[m_back]; }
+
+      /** Makes back() the newest value and hands the producer a new back().
+          Returns true if the previous newest value was never picked up */
+      bool publish()
+      {
+        int old = m_middle.fetchAndStoreOrdered(m_back | Fresh);
+        m_back = old & IndexMask;
+        return old & Fresh;
+      }
+
+      /** Moves the newest published value to front(). Returns false if
+          nothing was published since the last update */
+      bool update()
+      {
+        if (!((int)m_middle & Fresh)) {
+          return false;
+        }
+        int old = m_middle.fetchAndStoreOrdered(m_front);
+        m_front = old & IndexMask;
+        return true;
+      }
+
+      /** The value being read. Only the consumer may touch it */
+      T& front() { return m_slots[m_front]; }
+      const T& front() const { return m_slots[m_front]; }
+
+      /** Direct access for setup and teardown, while neither side runs */
+      T& slot(int i) { return m_slots[i]; }
+
+    private:
+      enum { IndexMask = 3, Fresh = 4 };
+
+      T m_slots[3];
+      int m_front;
+      int m_back;
+      QAtomicInt m_middle;
+  };
+
+}
+
+#endif //GNG_TRIPLEBUFFER_H